@@ -3,6 +3,7 @@
 
 #include "esp_err.h"
 #include "driver/i2c_master.h"
+#include "max17048_types.h"
 
 /**
  * @brief MAX17048 runtime configuration structure
@@ -12,8 +13,31 @@ typedef struct {
     uint16_t device_address;                  // Device I2C address (default: 0x36)
     uint32_t i2c_freq_hz;                     // I2C frequency (default: 100000)
     uint32_t i2c_timeout_ms;                  // I2C timeout (default: 1000)
+    max17048_variant_t variant;               // Gauge variant (default: MAX17048, or the one pinned in menuconfig)
 } max17048_config_t;
 
+/**
+ * @brief Number of I2C latency histogram buckets (the last one is unbounded)
+ */
+#define MAX17048_STATS_LATENCY_BUCKETS 8
+
+/**
+ * @brief Upper bounds of the latency buckets in microseconds (100, 200, 500 us, 1, 2, 5, 10 ms)
+ */
+extern const uint32_t max17048_stats_latency_bounds_us[MAX17048_STATS_LATENCY_BUCKETS - 1];
+
+/**
+ * @brief Driver statistics, covering every gauge the component talks to
+ */
+typedef struct {
+    uint32_t transactions;                    // I2C transactions issued
+    uint32_t errors;                          // Transactions that failed
+    uint64_t latency_sum_us;                  // Sum of transaction latencies
+    uint32_t latency_buckets[MAX17048_STATS_LATENCY_BUCKETS]; // Transactions per latency bucket
+    uint32_t cache_hits;                      // Reads served from the sampler's latest snapshot
+    uint32_t cache_misses;                    // Cached reads that found no data yet
+} max17048_stats_t;
+
 /**
  * @brief Get default configuration for MAX17048.
  *
@@ -30,6 +54,7 @@ void max17048_get_default_config(max17048_config_t *config);
  * @param config Pointer to configuration structure.
  * @return
  *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the variant is unknown or differs from the one pinned in menuconfig
  *      - ESP_FAIL if initialization fails or device not found
  */
 esp_err_t max17048_init_with_config(const max17048_config_t *config);
@@ -98,7 +123,7 @@ esp_err_t max17048_init_on_bus(i2c_port_t i2c_num);
 esp_err_t max17048_get_soc(float *soc);
 
 /**
- * @brief Get the battery's cell voltage.
+ * @brief Get the battery voltage: the cell on a MAX17048, the two-cell stack on a MAX17049.
  *
  * @param voltage Pointer to a float where the voltage will be stored.
  * @return
@@ -118,6 +143,93 @@ esp_err_t max17048_get_voltage(float *voltage);
  */
 esp_err_t max17048_get_crate(float *crate);
 
+/**
+ * @brief Read VCELL, SOC and CRATE in as few I2C transactions as possible.
+ *
+ * VCELL and SOC are fetched with a single burst read, CRATE with a second one.
+ *
+ * @param snapshot Pointer to a snapshot structure to fill.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if snapshot is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ *      - ESP_FAIL if read fails
+ */
+esp_err_t max17048_read_snapshot(max17048_snapshot_t *snapshot);
+
+/**
+ * @brief Time-to-empty value returned when the cell is not discharging
+ */
+#define MAX17048_TTE_INFINITE UINT32_MAX
+
+/**
+ * @brief Predict time-to-empty from raw SOC and CRATE values.
+ *
+ * Integer-only linear projection of the current discharge rate.
+ *
+ * @param soc Raw SOC register value (LSB = 1/256%).
+ * @param crate Raw CRATE register value (LSB = 0.208%/hr), e.g. a filtered trend.
+ * @return Seconds until SOC reaches 0%, or MAX17048_TTE_INFINITE if crate >= 0.
+ */
+uint32_t max17048_tte_seconds(uint16_t soc, int16_t crate);
+
+/**
+ * @brief Get a consistent copy of the driver statistics.
+ *
+ * @param stats Pointer to a statistics structure to fill.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if stats is NULL
+ */
+esp_err_t max17048_get_stats(max17048_stats_t *stats);
+
+/**
+ * @brief Reset all driver statistics to zero.
+ */
+void max17048_reset_stats(void);
+
+/**
+ * @brief Set the RCOMP temperature compensation value (CONFIG high byte).
+ *
+ * The alert settings in the low byte of CONFIG are preserved.
+ *
+ * @param rcomp New RCOMP value (power-on default 0x97).
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ *      - ESP_FAIL if the bus transfer fails
+ */
+esp_err_t max17048_set_rcomp(uint8_t rcomp);
+
+/**
+ * @brief Get the current RCOMP value.
+ *
+ * @param rcomp Pointer to a uint8_t to store RCOMP.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if rcomp is NULL
+ *      - ESP_FAIL if read fails
+ */
+esp_err_t max17048_get_rcomp(uint8_t *rcomp);
+
+/**
+ * @brief Get the configured gauge variant.
+ *
+ * With the variant pinned in menuconfig (CONFIG_MAX17048_VARIANT_MAX17048 or
+ * CONFIG_MAX17048_VARIANT_MAX17049) this is a constant and the voltage
+ * scaling that depends on it compiles away.
+ *
+ * @return MAX17048_VARIANT_MAX17048 or MAX17048_VARIANT_MAX17049.
+ */
+#ifdef MAX17048_FIXED_VARIANT
+static inline max17048_variant_t max17048_get_variant(void)
+{
+    return MAX17048_FIXED_VARIANT;
+}
+#else
+max17048_variant_t max17048_get_variant(void);
+#endif
+
 /**
  * @brief Get the production version of the IC.
  *
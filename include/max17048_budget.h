@@ -0,0 +1,126 @@
+#ifndef MAX17048_BUDGET_H
+#define MAX17048_BUDGET_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Number of learned cost classes (e.g. OTA, sensor burst, display refresh)
+ */
+#define MAX17048_BUDGET_MAX_CLASSES 8
+
+/**
+ * @brief Energy budget configuration structure
+ */
+typedef struct {
+    uint32_t capacity_mah;                    // Rated cell capacity, used to turn SOC deltas into charge
+    uint32_t service_interval_h;              // Runtime the device must reach from start
+    float reserve_soc;                        // SOC kept out of the budget (default: 5.0)
+    uint32_t window_ms;                       // Token window length (default: 60000)
+} max17048_budget_config_t;
+
+/**
+ * @brief Reservation handed out by max17048_budget_reserve()
+ */
+typedef struct {
+    uint8_t cost_class;                       // Class the reservation is learned under
+    uint32_t estimate_uah;                    // Caller's estimate
+    uint32_t reserved_uah;                    // Estimate scaled by the class's learned cost factor
+    uint32_t window;                          // Window the tokens were taken from
+    uint16_t start_soc;                       // Raw SOC when reserved
+    uint64_t start_drain_nah;                 // CRATE-integrated discharge when reserved
+    int64_t start_us;                         // Time when reserved
+} max17048_budget_ticket_t;
+
+/**
+ * @brief Get default configuration for the energy budget.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_budget_get_default_config(max17048_budget_config_t *config);
+
+/**
+ * @brief Start the energy budget service.
+ *
+ * The service listens to the sampler. At each window boundary it spreads the
+ * charge above reserve_soc over the windows left until the service interval
+ * ends, subtracts the learned baseline drain and offers the rest as tokens.
+ * Drain is integrated from CRATE once the sampler delivers it, and taken
+ * from SOC steps otherwise.
+ *
+ * The deadline is kept in RTC memory as wall-clock time, so a software,
+ * panic or watchdog reset or a deep-sleep wake continues the same interval.
+ * A power-on reset or a different service_interval_h starts a new one.
+ *
+ * @param config Pointer to configuration structure.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if the service is already running
+ *      - ESP_ERR_NO_MEM if no sampler listener slot is free
+ */
+esp_err_t max17048_budget_start(const max17048_budget_config_t *config);
+
+/**
+ * @brief Stop the energy budget service.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the service is not running, or called from a sampler listener
+ */
+esp_err_t max17048_budget_stop(void);
+
+/**
+ * @brief Start a new service interval from now, e.g. after the battery has been recharged.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the service is not running
+ */
+esp_err_t max17048_budget_restart_interval(void);
+
+/**
+ * @brief Reserve energy from the current window.
+ *
+ * @param cost_class Class whose learned cost factor scales the estimate.
+ * @param estimate_uah Expected consumption in uAh.
+ * @param ticket Filled with the reservation on success.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if cost_class is out of range or ticket is NULL
+ *      - ESP_ERR_INVALID_STATE if the service is not running or has no SOC yet
+ *      - ESP_ERR_NO_MEM if the window cannot afford the reservation
+ */
+esp_err_t max17048_budget_reserve(uint8_t cost_class, uint32_t estimate_uah, max17048_budget_ticket_t *ticket);
+
+/**
+ * @brief Settle a finished reservation against the observed SOC drop.
+ *
+ * Unused tokens go back to the window they came from (if still current) and
+ * the class's cost factor is updated from the observed consumption. The
+ * factor does not fall below 32 (1/8), so a class is never free.
+ *
+ * @param ticket Reservation to settle.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if ticket is NULL
+ *      - ESP_ERR_INVALID_STATE if the service is not running
+ */
+esp_err_t max17048_budget_settle(const max17048_budget_ticket_t *ticket);
+
+/**
+ * @brief Tokens left in the current window.
+ *
+ * @return Available charge in uAh.
+ */
+uint32_t max17048_budget_available_uah(void);
+
+/**
+ * @brief Learned cost factor of a class.
+ *
+ * @param cost_class Class index.
+ * @return Observed/estimated consumption ratio in Q8 (256 = estimates are accurate).
+ */
+uint32_t max17048_budget_get_cost_factor(uint8_t cost_class);
+
+#endif // MAX17048_BUDGET_H
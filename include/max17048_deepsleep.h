@@ -0,0 +1,95 @@
+#ifndef MAX17048_DEEPSLEEP_H
+#define MAX17048_DEEPSLEEP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+
+/**
+ * @brief Deep-sleep planner configuration structure
+ */
+typedef struct {
+    uint32_t capacity_mah;                    // Rated cell capacity
+    float low_soc;                            // SOC that must not be crossed unseen (default: 10.0)
+    float report_delta_soc;                   // Also wake before SOC can fall this far, 0 = off (default: 0)
+    uint32_t sleep_ua;                        // Sleep current assumed until a drain has been learned, 0 = use CRATE (default: 100)
+    uint8_t margin_pct;                       // Share of the predicted time actually slept (default: 80)
+    uint32_t min_sleep_s;                     // Shortest planned sleep (default: 60)
+    uint32_t max_sleep_s;                     // Longest planned sleep (default: 86400)
+    uint32_t min_learn_s;                     // Sleep time added up before the drain is updated (default: 1800)
+    gpio_num_t alert_gpio;                    // GPIO wired to the gauge ALRT pin, or GPIO_NUM_NC (default: GPIO_NUM_NC)
+} max17048_deepsleep_config_t;
+
+/**
+ * @brief Planned sleep
+ */
+typedef struct {
+    uint64_t sleep_us;                        // Duration to pass to the timer wakeup source
+    uint16_t soc;                             // Raw SOC the plan was made from
+    int16_t crate;                            // Raw CRATE the plan was made from
+    uint32_t drain_ua;                        // Sleep current the plan assumes
+    bool drain_learned;                       // drain_ua comes from previous sleeps rather than the configuration
+    bool below_low;                           // SOC is already at or below low_soc; sleep_us is min_sleep_s
+} max17048_deepsleep_plan_t;
+
+/**
+ * @brief Get default configuration for the deep-sleep planner.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_deepsleep_get_default_config(max17048_deepsleep_config_t *config);
+
+/**
+ * @brief Compute the longest safe deep-sleep duration.
+ *
+ * Reads SOC and CRATE and divides the charge left above low_soc (or
+ * report_delta_soc, if smaller) by the sleep drain, scaled by margin_pct
+ * and clamped to [min_sleep_s, max_sleep_s]. The drain is learned from the
+ * SOC lost across previous sleeps and kept in RTC memory; the first call
+ * after a deep-sleep wake folds in the last sleep. Sleeps are added up until
+ * they total min_learn_s and SOC has dropped by at least 16 LSB (1/16 %), so
+ * sleeps too short to move SOC are never learned as a zero drain. Until a drain is known,
+ * sleep_ua (or the awake CRATE if sleep_ua is 0) is assumed.
+ *
+ * @param config Pointer to configuration structure.
+ * @param plan Filled with the planned duration and its inputs.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL or the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ *      - ESP_FAIL if the gauge cannot be read
+ */
+esp_err_t max17048_deepsleep_plan(const max17048_deepsleep_config_t *config, max17048_deepsleep_plan_t *plan);
+
+/**
+ * @brief Arm the wakeup sources for a planned sleep.
+ *
+ * Enables the timer wakeup for plan->sleep_us and records the starting
+ * SOC for drain learning. With alert_gpio set, the gauge's empty alert is
+ * moved to low_soc (1-32 %, rounded up to a whole percent), a pending
+ * alert is cleared and a low level on the ALRT line is enabled as a wakeup
+ * source (EXT1, or the deep-sleep GPIO wakeup on targets without EXT1).
+ * Call esp_deep_sleep_start() afterwards.
+ *
+ * ALRT is open drain and the internal pull-ups are not kept in deep sleep,
+ * so the line needs an external pull-up (e.g. 10 kOhm) to a supply that
+ * stays on while the chip sleeps. Without one the line floats and the node
+ * wakes at random or never.
+ *
+ * @param config Configuration used for the plan.
+ * @param plan Plan from max17048_deepsleep_plan().
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL or low_soc cannot be set as an alert threshold
+ *      - ESP_ERR_NOT_SUPPORTED if alert_gpio cannot wake the chip from deep sleep
+ *      - ESP_FAIL if the gauge cannot be configured
+ */
+esp_err_t max17048_deepsleep_arm(const max17048_deepsleep_config_t *config, const max17048_deepsleep_plan_t *plan);
+
+/**
+ * @brief Forget the learned sleep drain, e.g. after swapping the battery.
+ */
+void max17048_deepsleep_reset_drain(void);
+
+#endif // MAX17048_DEEPSLEEP_H
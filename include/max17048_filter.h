@@ -0,0 +1,100 @@
+#ifndef MAX17048_FILTER_H
+#define MAX17048_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Upper bounds that fix the per-sample cost and the state size at compile time
+ */
+#define MAX17048_FILTER_MAX_STAGES 4           // Stages per pipeline
+#define MAX17048_FILTER_MAX_WINDOW 9           // Window of median and boxcar stages
+
+/**
+ * @brief Filter stage types
+ *
+ * All stages work on integers in raw register units, so a pipeline costs no
+ * float math per sample.
+ */
+typedef enum {
+    MAX17048_FILTER_MEDIAN,                    // Median of the last param samples (odd, <= MAX_WINDOW)
+    MAX17048_FILTER_EMA,                       // Exponential average, alpha = 1 / 2^param (1..15)
+    MAX17048_FILTER_BOXCAR,                    // Mean of the last param samples (<= MAX_WINDOW)
+    MAX17048_FILTER_DECIMATE,                  // Pass one of every param samples
+    MAX17048_FILTER_RATE_LIMIT,                // Limit the step between outputs to param raw units
+} max17048_filter_type_t;
+
+/**
+ * @brief Configuration of one filter stage
+ */
+typedef struct {
+    max17048_filter_type_t type;               // Stage type
+    uint16_t param;                            // Window, shift, factor or step depending on type
+} max17048_filter_stage_config_t;
+
+/**
+ * @brief Filter stage with preallocated state
+ */
+typedef struct {
+    max17048_filter_stage_config_t config;
+    union {
+        struct {
+            int32_t ring[MAX17048_FILTER_MAX_WINDOW];   // Samples in arrival order
+            int32_t sorted[MAX17048_FILTER_MAX_WINDOW]; // Same samples kept sorted (median)
+            int32_t sum;                                // Running sum (boxcar)
+            uint8_t head;
+            uint8_t count;
+        } window;
+        struct {
+            int32_t acc;                                // Average scaled by 2^param
+        } ema;
+        struct {
+            uint16_t count;
+        } decimate;
+        struct {
+            int32_t last;
+        } rate;
+    } state;
+    bool primed;
+} max17048_filter_stage_t;
+
+/**
+ * @brief Filter pipeline, applied stage by stage to each sample
+ */
+typedef struct {
+    max17048_filter_stage_t stages[MAX17048_FILTER_MAX_STAGES];
+    uint8_t num_stages;
+} max17048_filter_t;
+
+/**
+ * @brief Initialize a filter pipeline.
+ *
+ * @param filter Pipeline to initialize (caller-owned storage).
+ * @param stages Stage configurations, applied in order.
+ * @param num_stages Number of stages (1..MAX17048_FILTER_MAX_STAGES).
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if a stage parameter is out of range
+ */
+esp_err_t max17048_filter_init(max17048_filter_t *filter, const max17048_filter_stage_config_t *stages, size_t num_stages);
+
+/**
+ * @brief Clear the state of every stage, keeping the configuration.
+ *
+ * @param filter Pipeline to reset.
+ */
+void max17048_filter_reset(max17048_filter_t *filter);
+
+/**
+ * @brief Push one sample through the pipeline.
+ *
+ * @param filter Pipeline.
+ * @param in Input sample in raw register units.
+ * @param out Filtered output, valid only when true is returned.
+ * @return true if the pipeline produced an output, false if a decimator dropped the sample.
+ */
+bool max17048_filter_process(max17048_filter_t *filter, int32_t in, int32_t *out);
+
+#endif // MAX17048_FILTER_H
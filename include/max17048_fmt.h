@@ -0,0 +1,50 @@
+#ifndef MAX17048_FMT_H
+#define MAX17048_FMT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "max17048_regs.h"
+
+// Fixed-point formatting of battery readings without float printf or
+// allocation. Values are rendered from their exact decimal form and rounded
+// half away from zero; output is always NUL-terminated when size > 0.
+
+/**
+ * @brief Longest string any formatter produces, including the terminator
+ */
+#define MAX17048_FMT_MAX_LEN 41                // Sign, 20 integer digits, point, 18 decimals, NUL
+
+/**
+ * @brief Format a fixed-point value.
+ *
+ * @param buf Output buffer.
+ * @param size Output buffer size.
+ * @param value Value in units of 10^-value_decimals.
+ * @param value_decimals Decimal places held by value (0..18).
+ * @param decimals Decimal places to print (0..18); padded with zeros beyond value_decimals.
+ * @return Characters written excluding the terminator, or 0 if the buffer is too small.
+ */
+size_t max17048_fmt_fixed(char *buf, size_t size, int64_t value, uint8_t value_decimals, uint8_t decimals);
+
+/**
+ * @brief Format a raw VCELL value in volts per cell, e.g. "3.851".
+ */
+size_t max17048_fmt_vcell(char *buf, size_t size, uint16_t vcell, uint8_t decimals);
+
+/**
+ * @brief Format a raw VCELL value as the stack voltage of the given variant, e.g. "7.702".
+ */
+size_t max17048_fmt_vcell_stack(char *buf, size_t size, uint16_t vcell, max17048_variant_t variant,
+                                uint8_t decimals);
+
+/**
+ * @brief Format a raw SOC value in percent, e.g. "87.50".
+ */
+size_t max17048_fmt_soc(char *buf, size_t size, uint16_t soc, uint8_t decimals);
+
+/**
+ * @brief Format a raw CRATE value in %/hr, e.g. "-12.48".
+ */
+size_t max17048_fmt_crate(char *buf, size_t size, int16_t crate, uint8_t decimals);
+
+#endif // MAX17048_FMT_H
@@ -0,0 +1,76 @@
+#ifndef MAX17048_FORENSIC_H
+#define MAX17048_FORENSIC_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_system.h"
+
+/**
+ * @brief Number of snapshots kept in the rolling window
+ */
+#define MAX17048_FORENSIC_DEPTH 16
+
+/**
+ * @brief Register values of one sampler read, before any filtering
+ */
+typedef struct {
+    uint32_t time_ms;                         // Uptime of the recording boot when the sample was taken
+    uint16_t vcell;                           // VCELL register
+    uint16_t soc;                             // SOC register
+    int16_t crate;                            // CRATE register
+    uint16_t reserved;
+} max17048_forensic_entry_t;
+
+/**
+ * @brief Window recovered after an abnormal reset
+ */
+typedef struct {
+    esp_reset_reason_t reset_reason;          // Reason of the reset that ended the recording boot
+    uint32_t total_samples;                   // Samples recorded since the window was last cleared
+    uint8_t count;                            // Valid entries (up to MAX17048_FORENSIC_DEPTH)
+    max17048_forensic_entry_t entries[MAX17048_FORENSIC_DEPTH]; // Oldest first; the last one is the final sample
+} max17048_forensic_report_t;
+
+/**
+ * @brief Start recording snapshots into RTC no-init memory.
+ *
+ * On the first call after boot the reset reason is checked: after a
+ * brownout, panic or watchdog reset a window left by the previous boot is
+ * kept as the report and recording restarts; after a deep-sleep wake the
+ * window carries on; after any other reset it is discarded. Each sampler
+ * read is then recorded from a raw listener, ahead of the filters, at the
+ * cost of one slot write and a head update.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if already started
+ *      - ESP_ERR_NO_MEM if no raw sampler listener slot is free
+ */
+esp_err_t max17048_forensic_start(void);
+
+/**
+ * @brief Stop recording. The window stays in RTC memory.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if not started, or called from a sampler listener
+ */
+esp_err_t max17048_forensic_stop(void);
+
+/**
+ * @brief Get the window recovered at boot.
+ *
+ * @param report Filled with the reset reason and the final samples.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if report is NULL
+ *      - ESP_ERR_NOT_FOUND if the last reset was not abnormal or no valid window survived
+ */
+esp_err_t max17048_forensic_get_report(max17048_forensic_report_t *report);
+
+/**
+ * @brief Drop the recovered report, e.g. once it has been uploaded.
+ */
+void max17048_forensic_clear_report(void);
+
+#endif // MAX17048_FORENSIC_H
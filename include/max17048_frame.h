@@ -0,0 +1,125 @@
+#ifndef MAX17048_FRAME_H
+#define MAX17048_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "max17048_types.h"
+
+/**
+ * @brief Binary snapshot frame
+ *
+ * Little-endian layout, shared by the flash journal, the uplink publisher
+ * and host-side decoders:
+ *
+ *   u8  magic (0xB7)   u8 version (1)   u16 record count   u64 device id
+ *   records...         u32 CRC-32 (IEEE) over everything before it
+ *
+ * The first record holds absolute values, later records hold deltas to the
+ * previous one. Timestamps are unsigned LEB128 varints, VCELL/SOC/CRATE are
+ * zigzag-encoded signed varints, so a steady 1 Hz series packs into about
+ * 6 bytes per snapshot instead of 14.
+ */
+#define MAX17048_FRAME_MAGIC 0xB7
+#define MAX17048_FRAME_VERSION 1
+#define MAX17048_FRAME_HEADER_SIZE 12
+#define MAX17048_FRAME_TRAILER_SIZE 4
+#define MAX17048_FRAME_MAX_RECORD_SIZE 19     // 10-byte timestamp + 3 x 3-byte field varints
+
+/**
+ * @brief Incremental frame encoder over a caller buffer
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    uint16_t count;
+    max17048_snapshot_t prev;
+} max17048_frame_encoder_t;
+
+/**
+ * @brief Incremental frame decoder over a received buffer
+ */
+typedef struct {
+    const uint8_t *buf;
+    size_t len;                               // Length without the trailer
+    size_t pos;
+    uint16_t count;
+    uint16_t index;
+    uint64_t device_id;
+    max17048_snapshot_t prev;
+} max17048_frame_decoder_t;
+
+/**
+ * @brief Start a new frame.
+ *
+ * @param enc Encoder state.
+ * @param buf Output buffer.
+ * @param size Output buffer size (at least header + trailer).
+ * @param device_id Identifier of the sending device (0 when unused).
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL
+ *      - ESP_ERR_INVALID_SIZE if the buffer is too small
+ */
+esp_err_t max17048_frame_begin(max17048_frame_encoder_t *enc, uint8_t *buf, size_t size, uint64_t device_id);
+
+/**
+ * @brief Append a snapshot to the frame.
+ *
+ * @param enc Encoder state.
+ * @param snapshot Snapshot to append; timestamps must not go backwards.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NO_MEM if the record does not fit (frame is left unchanged)
+ *      - ESP_ERR_INVALID_ARG if the timestamp goes backwards or the frame holds 65535 records
+ */
+esp_err_t max17048_frame_add(max17048_frame_encoder_t *enc, const max17048_snapshot_t *snapshot);
+
+/**
+ * @brief Close the frame by writing the record count and CRC.
+ *
+ * @param enc Encoder state.
+ * @param len Returned total frame length.
+ * @return
+ *      - ESP_OK on success
+ */
+esp_err_t max17048_frame_finish(max17048_frame_encoder_t *enc, size_t *len);
+
+/**
+ * @brief Validate a frame and prepare to decode its records.
+ *
+ * @param dec Decoder state.
+ * @param buf Frame bytes.
+ * @param len Frame length.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_SIZE if the frame is truncated
+ *      - ESP_ERR_INVALID_VERSION if magic or version do not match
+ *      - ESP_ERR_INVALID_CRC if the CRC does not match
+ */
+esp_err_t max17048_frame_decode_begin(max17048_frame_decoder_t *dec, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode the next snapshot.
+ *
+ * @param dec Decoder state.
+ * @param snapshot Decoded snapshot.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND when all records have been decoded
+ *      - ESP_ERR_INVALID_RESPONSE if a record is malformed or a field leaves its 16-bit register range
+ */
+esp_err_t max17048_frame_decode_next(max17048_frame_decoder_t *dec, max17048_snapshot_t *snapshot);
+
+/**
+ * @brief CRC-32 (IEEE 802.3, as zlib) used for frame trailers.
+ *
+ * @param crc Previous CRC, 0 to start.
+ * @param data Bytes to add.
+ * @param len Number of bytes.
+ * @return Updated CRC.
+ */
+uint32_t max17048_frame_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+#endif // MAX17048_FRAME_H
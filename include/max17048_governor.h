@@ -0,0 +1,82 @@
+#ifndef MAX17048_GOVERNOR_H
+#define MAX17048_GOVERNOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief One performance level of the governor
+ */
+typedef struct {
+    float min_soc;                            // Level is allowed at or above this SOC (%)
+    float min_tte_h;                          // ... and at or above this time-to-empty (hours, 0 = ignore)
+    int max_freq_mhz;                         // esp_pm maximum CPU frequency
+    int min_freq_mhz;                         // esp_pm minimum CPU frequency
+    bool light_sleep_enable;                  // esp_pm automatic light sleep
+} max17048_governor_level_t;
+
+/**
+ * @brief Governor configuration structure
+ */
+typedef struct {
+    const max17048_governor_level_t *levels;  // Levels from most to least performance (copied on start)
+    size_t num_levels;                        // Number of levels (1..MAX17048_GOVERNOR_MAX_LEVELS)
+    float hysteresis_soc;                     // Extra SOC needed to step up a level (default: 2.0)
+    float hysteresis_tte_h;                   // Extra time-to-empty needed to step up a level (default: 0.5)
+    uint8_t crate_trend_shift;                // CRATE trend EMA, alpha = 1 / 2^shift (default: 4)
+} max17048_governor_config_t;
+
+/**
+ * @brief Maximum number of governor levels
+ */
+#define MAX17048_GOVERNOR_MAX_LEVELS 8
+
+/**
+ * @brief Get default configuration for the governor.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_governor_get_default_config(max17048_governor_config_t *config);
+
+/**
+ * @brief Start driving esp_pm from sampler snapshots.
+ *
+ * The governor listens to the sampler, tracks a smoothed CRATE trend and the
+ * predicted time-to-empty, and calls esp_pm_configure() only when the
+ * selected level changes. Stepping down is immediate; stepping up needs the
+ * configured hysteresis margin. Requires CONFIG_PM_ENABLE.
+ *
+ * A level esp_pm_configure() rejects is skipped for the next less
+ * performant one and not tried again until the governor is restarted:
+ * esp_pm_configure() only rejects settings the chip or the build cannot run
+ * (an unsupported frequency, light sleep without tickless idle), which do
+ * not change at run time.
+ *
+ * @param config Pointer to configuration structure.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if the governor is already running
+ *      - ESP_ERR_NOT_SUPPORTED if power management is disabled (CONFIG_PM_ENABLE)
+ *      - ESP_ERR_NO_MEM if no sampler listener slot is free
+ */
+esp_err_t max17048_governor_start(const max17048_governor_config_t *config);
+
+/**
+ * @brief Stop the governor. The last applied esp_pm settings stay in effect.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the governor is not running
+ */
+esp_err_t max17048_governor_stop(void);
+
+/**
+ * @brief Get the index of the level currently applied.
+ *
+ * @return Level index, or -1 if no level has been applied yet.
+ */
+int max17048_governor_get_level(void);
+
+#endif // MAX17048_GOVERNOR_H
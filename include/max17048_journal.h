@@ -0,0 +1,176 @@
+#ifndef MAX17048_JOURNAL_H
+#define MAX17048_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "max17048_types.h"
+
+/**
+ * @brief Record types written by the driver; application types start at MAX17048_JOURNAL_RECORD_USER
+ */
+#define MAX17048_JOURNAL_RECORD_HISTORY 0x0001  // max17048_frame snapshot history
+#define MAX17048_JOURNAL_RECORD_COUNTERS 0x0002 // Application-defined counter block
+#define MAX17048_JOURNAL_RECORD_BOOT 0x0003     // max17048_journal_boot_t, written on open
+#define MAX17048_JOURNAL_RECORD_USER 0x0100
+
+/**
+ * @brief Opaque handle for an open journal
+ */
+typedef struct max17048_journal_t *max17048_journal_handle_t;
+
+/**
+ * @brief Journal configuration structure
+ */
+typedef struct {
+    const char *partition_label;              // Data partition to use (default: "max17048")
+    size_t write_buffer_size;                 // RAM batch buffer, also the record size limit (default: 512)
+} max17048_journal_config_t;
+
+/**
+ * @brief Payload of a MAX17048_JOURNAL_RECORD_BOOT record
+ *
+ * Snapshot timestamps restart with every boot. A reader orders records by
+ * boot and places them in wall-clock time with wall_us + (timestamp_us - uptime_us).
+ */
+typedef struct {
+    uint32_t boot;                            // Boot number, one more than that of the previous open
+    uint32_t reserved;
+    int64_t uptime_us;                        // esp_timer_get_time() at open, the clock of snapshot timestamps
+    int64_t wall_us;                          // gettimeofday() at open, 0 if the clock was not set
+} max17048_journal_boot_t;
+
+/**
+ * @brief Read position in the journal
+ */
+typedef struct {
+    uint32_t seq;                             // Sector sequence number
+    uint32_t offset;                          // Byte offset inside that sector
+    uint32_t boot;                            // Boot that wrote the record last read
+} max17048_journal_cursor_t;
+
+/**
+ * @brief Journal write statistics
+ */
+typedef struct {
+    uint32_t bytes_appended;                  // Payload bytes accepted by append
+    uint32_t bytes_written;                   // Bytes written to flash (headers and padding included)
+    uint32_t flash_writes;                    // esp_partition_write calls
+    uint32_t sectors_erased;
+} max17048_journal_stats_t;
+
+/**
+ * @brief Get default configuration for the journal.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_journal_get_default_config(max17048_journal_config_t *config);
+
+/**
+ * @brief Open the journal and recover its tail.
+ *
+ * Only the 12-byte header of each sector and the records of the newest
+ * sector are read. A torn record at the tail is abandoned by continuing in
+ * the next sector. A partition without any journal sector is formatted.
+ * The boot number is then incremented and a MAX17048_JOURNAL_RECORD_BOOT
+ * record is appended; the number is also kept in every sector header.
+ *
+ * @param config Pointer to configuration structure.
+ * @param ret_journal Returned journal handle.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_NOT_FOUND if the partition does not exist
+ *      - ESP_ERR_NO_MEM if allocation fails
+ *      - Flash error otherwise
+ */
+esp_err_t max17048_journal_open(const max17048_journal_config_t *config, max17048_journal_handle_t *ret_journal);
+
+/**
+ * @brief Flush pending records and close the journal.
+ *
+ * @param journal Journal handle.
+ * @return
+ *      - ESP_OK on success
+ *      - Flash error if the final flush fails (the handle is released anyway)
+ */
+esp_err_t max17048_journal_close(max17048_journal_handle_t journal);
+
+/**
+ * @brief Append a CRC-protected record.
+ *
+ * Records are collected in the RAM buffer and written in one batch when it
+ * fills, when the sector is full or on max17048_journal_flush(). Each byte
+ * is written to flash once; the oldest sector is erased when the ring wraps.
+ *
+ * @param journal Journal handle.
+ * @param type Record type.
+ * @param data Payload.
+ * @param len Payload length (up to write_buffer_size - 8).
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_SIZE if the record is too large
+ *      - Flash error otherwise
+ */
+esp_err_t max17048_journal_append(max17048_journal_handle_t journal, uint16_t type, const void *data, size_t len);
+
+/**
+ * @brief Append snapshots as compressed history records.
+ *
+ * @param journal Journal handle.
+ * @param snapshots Snapshots in time order.
+ * @param count Number of snapshots.
+ * @return
+ *      - ESP_OK on success
+ *      - Error from the frame encoder or max17048_journal_append() otherwise
+ */
+esp_err_t max17048_journal_append_snapshots(max17048_journal_handle_t journal, const max17048_snapshot_t *snapshots, size_t count);
+
+/**
+ * @brief Write buffered records to flash.
+ *
+ * @param journal Journal handle.
+ * @return
+ *      - ESP_OK on success
+ *      - Flash error otherwise
+ */
+esp_err_t max17048_journal_flush(max17048_journal_handle_t journal);
+
+/**
+ * @brief Position a cursor at the oldest record.
+ *
+ * @param journal Journal handle.
+ * @param cursor Cursor to initialize.
+ */
+void max17048_journal_cursor_first(max17048_journal_handle_t journal, max17048_journal_cursor_t *cursor);
+
+/**
+ * @brief Read the record at the cursor and advance it.
+ *
+ * Records with a bad CRC end their sector and are skipped. cursor->boot
+ * is updated to the boot that wrote the returned record.
+ *
+ * @param journal Journal handle.
+ * @param cursor Read position.
+ * @param type Returned record type.
+ * @param buf Payload buffer.
+ * @param size Payload buffer size.
+ * @param len Returned payload length.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND at the end of the journal
+ *      - ESP_ERR_INVALID_SIZE if buf is too small (the cursor is not advanced)
+ *      - Flash error otherwise
+ */
+esp_err_t max17048_journal_read_next(max17048_journal_handle_t journal, max17048_journal_cursor_t *cursor,
+                                     uint16_t *type, void *buf, size_t size, size_t *len);
+
+/**
+ * @brief Get write statistics; bytes_written / bytes_appended is the write amplification.
+ *
+ * @param journal Journal handle.
+ * @param stats Returned statistics.
+ */
+void max17048_journal_get_stats(max17048_journal_handle_t journal, max17048_journal_stats_t *stats);
+
+#endif // MAX17048_JOURNAL_H
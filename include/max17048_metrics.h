@@ -0,0 +1,62 @@
+#ifndef MAX17048_METRICS_H
+#define MAX17048_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "max17048.h"
+
+/**
+ * @brief Smallest output buffer that always fits one exposition line
+ */
+#define MAX17048_METRICS_MIN_BUFFER 160
+
+/**
+ * @brief One gauge to expose; label becomes gauge="<label>"
+ */
+typedef struct {
+    const char *label;                        // Label value, must not need escaping
+    const max17048_snapshot_t *snapshot;      // Latest snapshot of this gauge
+} max17048_metrics_gauge_t;
+
+/**
+ * @brief Incremental OpenMetrics renderer
+ */
+typedef struct {
+    const max17048_stats_t *stats;            // Driver statistics, NULL to skip them
+    const max17048_metrics_gauge_t *gauges;
+    size_t num_gauges;
+    uint8_t family;                           // Cursor: metric family
+    size_t line;                              // Cursor: line within the family
+} max17048_metrics_renderer_t;
+
+/**
+ * @brief Prepare a renderer. Nothing is copied; the inputs must stay valid until rendering completes.
+ *
+ * @param renderer Renderer state.
+ * @param stats Driver statistics (see max17048_get_stats()), or NULL.
+ * @param gauges Gauges to expose, or NULL.
+ * @param num_gauges Number of gauges.
+ */
+void max17048_metrics_begin(max17048_metrics_renderer_t *renderer, const max17048_stats_t *stats,
+                            const max17048_metrics_gauge_t *gauges, size_t num_gauges);
+
+/**
+ * @brief Render the next chunk of the exposition into a caller buffer.
+ *
+ * Only whole lines are written, and no memory is allocated, so the text can
+ * be streamed through a small buffer, e.g. one httpd_resp_send_chunk() per
+ * call. The exposition ends with "# EOF".
+ *
+ * @param renderer Renderer state.
+ * @param buf Output buffer (not NUL-terminated).
+ * @param size Output buffer size, at least MAX17048_METRICS_MIN_BUFFER.
+ * @param len Bytes written; 0 once the exposition is complete.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL
+ *      - ESP_ERR_INVALID_SIZE if the buffer cannot hold the next line
+ */
+esp_err_t max17048_metrics_render(max17048_metrics_renderer_t *renderer, char *buf, size_t size, size_t *len);
+
+#endif // MAX17048_METRICS_H
@@ -0,0 +1,157 @@
+#ifndef MAX17048_MODEL_H
+#define MAX17048_MODEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "max17048.h"
+#include "max17048_regs.h"
+
+/**
+ * @brief Number of OCV curve points per model, at 0, 10, ..., 100% SOC
+ */
+#define MAX17048_MODEL_OCV_POINTS 11
+
+/**
+ * @brief Minimum number of relaxed observations accepted by max17048_model_identify()
+ */
+#define MAX17048_MODEL_MIN_OBS 3
+
+/**
+ * @brief Custom ModelGauge model of one cell type, as delivered in the cell's model file
+ *
+ * Declare catalogues as const arrays so they stay in flash. Temperature
+ * coefficients are RCOMP steps per degree C in Q8 (e.g. -0.5 is -128).
+ */
+typedef struct {
+    const char *name;                         // Cell vendor / part, for logs
+    uint8_t table[MAX17048_MODEL_TABLE_SIZE]; // Model data for 0x40-0x7F
+    uint16_t rcomp_seg;                       // RCOMPSeg, written to all 16 words at 0x80
+    uint8_t rcomp0;                           // RCOMP at 20 degrees C
+    int16_t temp_co_up_q8;                    // RCOMP change per degree above 20 C
+    int16_t temp_co_down_q8;                  // RCOMP change per degree below 20 C
+    uint16_t ocv_test;                        // OCVTest, raw VCELL units
+    uint8_t soc_check_a;                      // Expected SOC high byte range after loading
+    uint8_t soc_check_b;
+    bool bits19;                              // 19-bit model (SOC LSB 1/512 %)
+    uint16_t ocv_mv[MAX17048_MODEL_OCV_POINTS]; // Relaxed per-cell OCV curve used for identification
+} max17048_model_t;
+
+/**
+ * @brief One relaxed VCELL-vs-SOC observation
+ */
+typedef struct {
+    uint16_t vcell;                           // Raw VCELL after relaxation
+    uint16_t soc;                             // Raw SOC at the same time
+} max17048_model_obs_t;
+
+/**
+ * @brief Collects relaxed observations from the sampler
+ *
+ * A sample counts as relaxed once |CRATE| stayed at or below crate_relaxed
+ * for relax_ms; one observation is kept per min_soc_step of SOC movement.
+ */
+typedef struct {
+    max17048_model_obs_t *obs;                // Caller storage
+    size_t capacity;
+    size_t count;
+    int16_t crate_relaxed;                    // Raw CRATE bound (LSB 0.208 %/hr)
+    uint16_t min_soc_step;                    // Raw SOC distance between kept observations
+    int64_t relax_us;
+    int64_t quiet_since_us;                   // Start of the current quiet period, -1 if loaded
+    bool refining;                            // Last observation belongs to the current rest
+    uint16_t last_soc;
+} max17048_model_collector_t;
+
+/**
+ * @brief Result of model identification
+ */
+typedef struct {
+    size_t index;                             // Best matching catalogue entry
+    uint32_t error_uv;                        // Its mean absolute OCV error
+    uint32_t runner_up_error_uv;              // Mean error of the second best entry (UINT32_MAX if none)
+} max17048_model_match_t;
+
+/**
+ * @brief Initialize an observation collector.
+ *
+ * @param collector Collector to initialize.
+ * @param storage Array of capacity observations, owned by the caller.
+ * @param capacity Number of entries in storage.
+ * @param crate_relaxed_pct_hr |CRATE| at or below which the cell counts as resting, e.g. 0.5.
+ * @param relax_ms Rest time before VCELL is taken as OCV, e.g. 30 minutes.
+ * @param min_soc_step_pct SOC movement between kept observations, e.g. 5.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL or capacity is 0
+ */
+esp_err_t max17048_model_collector_init(max17048_model_collector_t *collector, max17048_model_obs_t *storage, size_t capacity,
+                                        float crate_relaxed_pct_hr, uint32_t relax_ms, float min_soc_step_pct);
+
+/**
+ * @brief Sampler listener adapter: max17048_sampler_add_listener(max17048_model_collector_cb, collector).
+ */
+void max17048_model_collector_cb(const max17048_snapshot_t *snapshot, void *collector);
+
+/**
+ * @brief Pick the catalogue model whose OCV curve best fits the observations.
+ *
+ * Each model is scored by the mean absolute difference between observed
+ * VCELL and its OCV curve interpolated at the observed SOC. Observations
+ * should span a wide SOC range; SOC comes from the model currently loaded,
+ * so a clear margin between the best and second-best model is required.
+ *
+ * @param models Catalogue.
+ * @param num_models Number of catalogue entries.
+ * @param obs Relaxed observations.
+ * @param num_obs Number of observations (at least MAX17048_MODEL_MIN_OBS).
+ * @param min_margin_uv Required lead of the best model over the runner-up.
+ * @param match Result, filled even when the match is ambiguous.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL or num_models is 0
+ *      - ESP_ERR_INVALID_SIZE if there are too few observations
+ *      - ESP_ERR_NOT_FOUND if the best model does not lead by min_margin_uv
+ */
+esp_err_t max17048_model_identify(const max17048_model_t *models, size_t num_models, const max17048_model_obs_t *obs,
+                                  size_t num_obs, uint32_t min_margin_uv, max17048_model_match_t *match);
+
+/**
+ * @brief Upload a model to the gauge and set its RCOMP0.
+ *
+ * Follows the ModelGauge loading sequence: unlock, write OCVTest, write the
+ * table and RCOMPSeg, verify the resulting SOC against the check range,
+ * restore CONFIG, OCV and HIBRT, lock. The restore also runs when a step
+ * after the unlock fails, so the gauge is never left on the test OCV; the
+ * model's RCOMP0 is applied only if the SOC check passed. Blocks for at
+ * least 350 ms.
+ *
+ * @param model Model to load.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if model is NULL
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized or the model cannot be unlocked
+ *      - ESP_ERR_INVALID_RESPONSE if the SOC check fails
+ *      - ESP_FAIL if a bus transfer fails
+ */
+esp_err_t max17048_model_load(const max17048_model_t *model);
+
+/**
+ * @brief Identify the fitted cell and load its model.
+ *
+ * @return Same as max17048_model_identify(), then max17048_model_load().
+ */
+esp_err_t max17048_model_auto_load(const max17048_model_t *models, size_t num_models, const max17048_model_obs_t *obs,
+                                   size_t num_obs, uint32_t min_margin_uv, max17048_model_match_t *match);
+
+/**
+ * @brief RCOMP for a cell temperature from the model's coefficients.
+ *
+ * @param model Model.
+ * @param temp_dc Temperature in 0.1 degrees C.
+ * @return RCOMP clamped to 0..255.
+ */
+uint8_t max17048_model_rcomp(const max17048_model_t *model, int32_t temp_dc);
+
+#endif // MAX17048_MODEL_H
@@ -0,0 +1,90 @@
+#ifndef MAX17048_OTA_H
+#define MAX17048_OTA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/**
+ * @brief Cost class value for workloads without a learned correction
+ */
+#define MAX17048_OTA_NO_COST_CLASS 0xFF
+
+/**
+ * @brief OTA readiness configuration structure
+ */
+typedef struct {
+    uint32_t capacity_mah;                    // Rated cell capacity
+    float reserve_soc;                        // SOC that must remain after the workload (default: 10.0)
+    uint16_t cutoff_mv;                       // Lowest acceptable per-cell voltage under load (default: 3300)
+    uint16_t idle_ma;                         // Discharge below this counts as resting for sag tracking, must be > 0 (default: 20)
+} max17048_ota_config_t;
+
+/**
+ * @brief Workload to check
+ */
+typedef struct {
+    uint32_t image_size;                      // Bytes to download and write
+    uint32_t throughput_bps;                  // Expected download throughput in bytes/s
+    uint16_t radio_ma;                        // Average current while downloading
+    uint16_t flash_uah_per_kb;                // Charge to erase and write 1 KB of flash
+    uint8_t cost_class;                       // Energy budget class with a learned cost factor, or MAX17048_OTA_NO_COST_CLASS
+} max17048_ota_workload_t;
+
+/**
+ * @brief Go/no-go decision with margins
+ */
+typedef struct {
+    bool go;                                  // Both the charge and the voltage margin are non-negative
+    uint32_t required_uah;                    // Predicted consumption of the workload
+    float margin_soc;                         // SOC left above reserve_soc afterwards (negative = short)
+    int32_t margin_mv;                        // Predicted VCELL under radio load minus cutoff_mv
+} max17048_ota_decision_t;
+
+/**
+ * @brief Get default configuration for the OTA readiness predictor.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_ota_get_default_config(max17048_ota_config_t *config);
+
+/**
+ * @brief Start tracking battery state for OTA readiness.
+ *
+ * Listens to the sampler and caches SOC, the resting VCELL and a peak-held
+ * internal resistance estimate derived from VCELL sag at CRATE-derived load.
+ *
+ * @param config Pointer to configuration structure.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if already started
+ *      - ESP_ERR_NO_MEM if no sampler listener slot is free
+ */
+esp_err_t max17048_ota_start(const max17048_ota_config_t *config);
+
+/**
+ * @brief Stop tracking battery state.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if not started
+ */
+esp_err_t max17048_ota_stop(void);
+
+/**
+ * @brief Decide whether the remaining charge covers a workload.
+ *
+ * Runs in constant time from cached state; no bus access. The estimate is
+ * scaled by the learned cost factor of the workload's energy budget class.
+ *
+ * @param workload Workload description.
+ * @param decision Filled with the decision and margins.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL or throughput_bps is 0
+ *      - ESP_ERR_INVALID_STATE if not started or no snapshot has been seen yet
+ */
+esp_err_t max17048_ota_check(const max17048_ota_workload_t *workload, max17048_ota_decision_t *decision);
+
+#endif // MAX17048_OTA_H
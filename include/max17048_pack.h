@@ -0,0 +1,125 @@
+#ifndef MAX17048_PACK_H
+#define MAX17048_PACK_H
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "max17048.h"
+
+/**
+ * @brief Mux channel value for a gauge wired directly to the bus
+ */
+#define MAX17048_PACK_NO_MUX 0xFF
+
+/**
+ * @brief Opaque handle for a multi-gauge pack
+ */
+typedef struct max17048_pack_t *max17048_pack_handle_t;
+
+/**
+ * @brief Callback that routes a bus to one mux channel
+ *
+ * Every MAX17048 answers on the same address, so gauges sharing a bus sit
+ * behind an I2C mux (e.g. TCA9548A). The pack calls this only when the
+ * channel actually changes. With parallel_buses it may be called
+ * concurrently for different buses.
+ */
+typedef esp_err_t (*max17048_pack_mux_select_t)(i2c_master_bus_handle_t bus, uint8_t channel, void *user_ctx);
+
+/**
+ * @brief Location of one gauge in the pack
+ */
+typedef struct {
+    i2c_master_bus_handle_t i2c_bus_handle;  // I2C master bus the gauge is reachable on
+    uint8_t mux_channel;                      // Mux channel, or MAX17048_PACK_NO_MUX
+} max17048_pack_cell_t;
+
+/**
+ * @brief Pack configuration structure
+ */
+typedef struct {
+    const max17048_pack_cell_t *cells;       // Gauge locations, one per cell (copied on create)
+    size_t num_cells;                         // Number of entries in cells
+    uint16_t device_address;                  // Device I2C address (default: 0x36)
+    uint32_t i2c_freq_hz;                     // I2C frequency (default: 100000)
+    uint32_t i2c_timeout_ms;                  // I2C timeout (default: 1000)
+    max17048_pack_mux_select_t mux_select;    // Mux routing callback, NULL when no mux is used
+    void *mux_user_ctx;                       // Passed through to mux_select
+    uint32_t max_skew_us;                     // Max first-to-last sample skew, 0 = unbounded (default: 0)
+    uint8_t max_retries;                      // Extra sweeps allowed when the skew bound is missed (default: 2)
+    bool read_crate;                          // Also read CRATE (one more transaction per cell, default: false)
+    bool parallel_buses;                      // Sample each bus from its own worker task (default: false)
+    bool pin_workers;                         // Pin bus N's worker to core N % cores (default: false)
+    uint32_t worker_stack_size;               // Worker task stack in bytes (default: 3072)
+    UBaseType_t worker_priority;              // Worker task priority (default: 5)
+} max17048_pack_config_t;
+
+/**
+ * @brief Details of the last sweep
+ */
+typedef struct {
+    int64_t skew_us;                          // Time between first and last sample of the returned sweep
+    uint8_t attempts;                         // Sweeps performed, including the returned one
+    uint16_t transactions;                    // Gauge read transactions in the returned sweep
+    uint16_t mux_switches;                    // mux_select calls in the returned sweep
+} max17048_pack_sweep_info_t;
+
+/**
+ * @brief Get default configuration for a pack.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_pack_get_default_config(max17048_pack_config_t *config);
+
+/**
+ * @brief Create a pack of gauges and plan its sweep order.
+ *
+ * Cells are visited grouped by bus and in ascending mux channel order so a
+ * sweep needs at most one mux switch per cell. All gauges answer on the same
+ * address, so a bus carries either one direct (MAX17048_PACK_NO_MUX) gauge
+ * or muxed gauges only. With parallel_buses and cells
+ * on more than one bus, a worker task is started per bus so that the buses
+ * (e.g. both I2C controllers of an ESP32/ESP32-S3) are sampled concurrently.
+ *
+ * @param config Pointer to configuration structure.
+ * @param ret_pack Returned pack handle.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid or a bus mixes direct and muxed gauges
+ *      - ESP_ERR_NO_MEM if allocation fails
+ *      - Error from i2c_master_bus_add_device otherwise
+ */
+esp_err_t max17048_pack_create(const max17048_pack_config_t *config, max17048_pack_handle_t *ret_pack);
+
+/**
+ * @brief Delete a pack and release its I2C devices.
+ *
+ * @param pack Pack handle.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if pack is NULL
+ */
+esp_err_t max17048_pack_delete(max17048_pack_handle_t pack);
+
+/**
+ * @brief Sample every gauge back-to-back.
+ *
+ * In parallel mode every bus worker sweeps its cells at the same time and
+ * the results are merged; the skew then spans all buses.
+ * If max_skew_us is set and the sweep took longer, it is repeated up to
+ * max_retries times. The samples of the last sweep are always returned.
+ * Concurrent sweeps of the same pack are serialised.
+ *
+ * @param pack Pack handle.
+ * @param samples Array of num_cells snapshots, indexed like config->cells.
+ * @param info Optional pointer receiving sweep details.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL
+ *      - ESP_ERR_TIMEOUT if no sweep met the skew bound
+ *      - ESP_FAIL or I2C error if a read or mux switch fails
+ */
+esp_err_t max17048_pack_sweep(max17048_pack_handle_t pack, max17048_snapshot_t *samples, max17048_pack_sweep_info_t *info);
+
+#endif // MAX17048_PACK_H
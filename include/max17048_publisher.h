@@ -0,0 +1,99 @@
+#ifndef MAX17048_PUBLISHER_H
+#define MAX17048_PUBLISHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Transport callback; sends one max17048_frame. Any error counts as link trouble.
+ */
+typedef esp_err_t (*max17048_publisher_send_t)(const uint8_t *frame, size_t len, void *user_ctx);
+
+/**
+ * @brief Publisher configuration structure
+ */
+typedef struct {
+    max17048_publisher_send_t send;           // Transport callback
+    void *user_ctx;                           // Passed through to send
+    uint64_t device_id;                       // Device id written into each frame
+    size_t max_frame_size;                    // Frame is sealed when the next snapshot would not fit (default: 512)
+    uint32_t max_age_ms;                      // Frame is sealed when its first snapshot is this old (default: 60000)
+    uint8_t queue_len;                        // Sealed frames kept while the link is slow (default: 4)
+    uint32_t slow_send_ms;                    // Sends slower than this count as congestion (default: 2000)
+    uint32_t retry_ms;                        // Wait after a failed send (default: 5000)
+    uint32_t max_period_ms;                   // Upper bound when slowing the sampler down (default: 60000)
+    uint32_t task_stack_size;                 // Publisher task stack in bytes (default: 4096)
+    UBaseType_t task_priority;                // Publisher task priority (default: 4)
+} max17048_publisher_config_t;
+
+/**
+ * @brief Publisher statistics
+ */
+typedef struct {
+    uint32_t snapshots;                       // Snapshots batched
+    uint32_t frames_sent;
+    uint32_t bytes_sent;
+    uint32_t send_errors;
+    uint32_t frames_dropped;                  // Oldest frames discarded because the queue was full
+    uint32_t period_ms;                       // Sampler period currently requested
+} max17048_publisher_stats_t;
+
+/**
+ * @brief Get default configuration for the publisher.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_publisher_get_default_config(max17048_publisher_config_t *config);
+
+/**
+ * @brief Start batching sampler snapshots into compressed frames.
+ *
+ * Frames are sealed on size, on age or on max17048_publisher_flush() and sent
+ * from a dedicated task. When sends fail, are slow or the queue fills up,
+ * the sampler period is doubled (up to max_period_ms); once the queue
+ * drains with fast sends it is halved back towards the period at start.
+ * All buffers are allocated here: queue_len + 2 frames of max_frame_size
+ * (one filling, one being sent, queue_len waiting). After a failed send no
+ * frame is sent again until retry_ms has passed, however many new frames
+ * are sealed meanwhile.
+ *
+ * @param config Pointer to configuration structure.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if already running
+ *      - ESP_ERR_NO_MEM if allocation, task creation or listener registration fails
+ */
+esp_err_t max17048_publisher_start(const max17048_publisher_config_t *config);
+
+/**
+ * @brief Stop publishing. Unsent frames are discarded and the sampler period is restored.
+ *
+ * Waits for a snapshot callback in progress and for the send task to exit,
+ * so it must not be called from a sampler listener or from the send callback.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if not running, or called from a sampler listener
+ */
+esp_err_t max17048_publisher_stop(void);
+
+/**
+ * @brief Seal the current frame and send it now, e.g. from an alert rule callback.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if not running
+ */
+esp_err_t max17048_publisher_flush(void);
+
+/**
+ * @brief Get publisher statistics.
+ *
+ * @param stats Pointer to a statistics structure to fill.
+ */
+void max17048_publisher_get_stats(max17048_publisher_stats_t *stats);
+
+#endif // MAX17048_PUBLISHER_H
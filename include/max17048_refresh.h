@@ -0,0 +1,150 @@
+#ifndef MAX17048_REFRESH_H
+#define MAX17048_REFRESH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "max17048.h"
+
+/**
+ * @brief Registers the refresh planner can keep fresh, in address order
+ */
+typedef enum {
+    MAX17048_REFRESH_VCELL,                   // 0x02
+    MAX17048_REFRESH_SOC,                     // 0x04
+    MAX17048_REFRESH_MODE,                    // 0x06
+    MAX17048_REFRESH_VERSION,                 // 0x08
+    MAX17048_REFRESH_HIBRT,                   // 0x0A
+    MAX17048_REFRESH_CONFIG,                  // 0x0C
+    MAX17048_REFRESH_VALRT,                   // 0x14
+    MAX17048_REFRESH_CRATE,                   // 0x16
+    MAX17048_REFRESH_VRESET_ID,               // 0x18
+    MAX17048_REFRESH_STATUS,                  // 0x1A
+    MAX17048_REFRESH_REG_MAX,
+} max17048_refresh_reg_t;
+
+/**
+ * @brief Maximum number of bursts one tick can need (every other register due)
+ */
+#define MAX17048_REFRESH_MAX_BURSTS ((MAX17048_REFRESH_REG_MAX + 1) / 2)
+
+/**
+ * @brief Bus bytes around each read transaction: address+W, register pointer, address+R
+ */
+#define MAX17048_REFRESH_TXN_OVERHEAD 3
+
+/**
+ * @brief One burst read
+ */
+typedef struct {
+    uint8_t reg;                              // First register address
+    uint8_t len;                              // Bytes to read
+} max17048_refresh_burst_t;
+
+/**
+ * @brief Refresh counters
+ */
+typedef struct {
+    uint32_t ticks;                           // Ticks with at least one register due
+    uint32_t transactions;                    // Bursts issued
+    uint64_t bus_bytes;                       // Bytes on the bus, including per-transaction overhead
+    uint64_t bus_bytes_saved;                 // Against reading every register on each of those ticks
+} max17048_refresh_stats_t;
+
+/**
+ * @brief Refresh planner with a cache of the last value of every register
+ */
+typedef struct {
+    uint32_t interval_ms[MAX17048_REFRESH_REG_MAX]; // 0 = never refreshed
+    int64_t next_due_us[MAX17048_REFRESH_REG_MAX];
+    int64_t updated_us[MAX17048_REFRESH_REG_MAX];   // Timestamp of the cached value, -1 if none
+    uint16_t value[MAX17048_REFRESH_REG_MAX];
+    max17048_refresh_stats_t stats;
+} max17048_refresh_t;
+
+/**
+ * @brief Initialize a planner. Every register with an interval is due on the first tick.
+ *
+ * Example: VCELL and STATUS every 1000 ms, SOC 5000 ms, CRATE 10000 ms,
+ * CONFIG/HIBRT/VERSION 0 (read once with max17048_refresh_request()).
+ *
+ * @param planner Planner to initialize.
+ * @param interval_ms Refresh interval per register, indexed by max17048_refresh_reg_t.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL
+ */
+esp_err_t max17048_refresh_init(max17048_refresh_t *planner, const uint32_t interval_ms[MAX17048_REFRESH_REG_MAX]);
+
+/**
+ * @brief Change the interval of one register; it becomes due at its next multiple from now.
+ *
+ * @param planner Planner.
+ * @param reg Register.
+ * @param interval_ms New interval, 0 = never.
+ * @param now_us Current time.
+ */
+void max17048_refresh_set_interval(max17048_refresh_t *planner, max17048_refresh_reg_t reg, uint32_t interval_ms,
+                                   int64_t now_us);
+
+/**
+ * @brief Make a register due on the next tick regardless of its interval.
+ */
+void max17048_refresh_request(max17048_refresh_t *planner, max17048_refresh_reg_t reg);
+
+/**
+ * @brief Compute the bursts for the registers due at now_us.
+ *
+ * Due registers are merged into contiguous bursts; a gap of readable
+ * registers is read through when that costs fewer bus bytes than a new
+ * transaction. Pure function of the planner state.
+ *
+ * @param planner Planner.
+ * @param now_us Current time.
+ * @param bursts Output array of MAX17048_REFRESH_MAX_BURSTS entries.
+ * @param due_mask Optional output, bit n set if register n is due.
+ * @return Number of bursts.
+ */
+size_t max17048_refresh_plan(const max17048_refresh_t *planner, int64_t now_us, max17048_refresh_burst_t *bursts,
+                             uint16_t *due_mask);
+
+/**
+ * @brief Refresh the due registers of the initialized gauge.
+ *
+ * @param planner Planner.
+ * @param now_us Current time, e.g. esp_timer_get_time().
+ * @param updated_mask Optional output, bit n set if register n was refreshed.
+ * @return
+ *      - ESP_OK on success (also when nothing was due)
+ *      - ESP_ERR_INVALID_STATE if the driver is not initialized
+ *      - ESP_FAIL if a burst fails (registers of earlier bursts are still updated)
+ */
+esp_err_t max17048_refresh_tick(max17048_refresh_t *planner, int64_t now_us, uint16_t *updated_mask);
+
+/**
+ * @brief Earliest time any register becomes due, INT64_MAX if none has an interval.
+ */
+int64_t max17048_refresh_next_due(const max17048_refresh_t *planner);
+
+/**
+ * @brief Get a cached register value.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if the register has not been read yet
+ */
+esp_err_t max17048_refresh_get(const max17048_refresh_t *planner, max17048_refresh_reg_t reg, uint16_t *value);
+
+/**
+ * @brief Fill a snapshot from the cached VCELL, SOC and CRATE.
+ *
+ * The timestamp is that of the most recently refreshed of the three.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if any of the three has not been read yet
+ */
+esp_err_t max17048_refresh_get_snapshot(const max17048_refresh_t *planner, max17048_snapshot_t *snapshot);
+
+#endif // MAX17048_REFRESH_H
@@ -0,0 +1,129 @@
+#ifndef MAX17048_REGS_H
+#define MAX17048_REGS_H
+
+#include <stdint.h>
+#include "max17048_types.h"
+
+// Register map and decoding, free of ESP-IDF dependencies so that host tools
+// and the Linux gateway daemon talk to the gauge exactly like the driver does
+
+// Register Addresses
+#define MAX17048_VCELL_REG 0x02
+#define MAX17048_SOC_REG 0x04
+#define MAX17048_MODE_REG 0x06
+#define MAX17048_VERSION_REG 0x08
+#define MAX17048_HIBRT_REG 0x0A
+#define MAX17048_CONFIG_REG 0x0C              // RCOMP in the high byte
+#define MAX17048_OCV_REG 0x0E                 // Readable/writable only while the model is unlocked
+#define MAX17048_VALRT_REG 0x14
+#define MAX17048_CRATE_REG 0x16
+#define MAX17048_VRESET_ID_REG 0x18
+#define MAX17048_STATUS_REG 0x1A
+#define MAX17048_MODEL_LOCK_REG 0x3E
+#define MAX17048_MODEL_TABLE_REG 0x40         // 64-byte model table, 0x40-0x7F
+#define MAX17048_RCOMPSEG_REG 0x80            // 16 RCOMPSeg words, 0x80-0x9F
+#define MAX17048_CMD_REG 0xFE
+
+// CONFIG low byte
+#define MAX17048_CONFIG_ALSC 0x0040           // Alert on every 1% SOC change
+#define MAX17048_CONFIG_ALRT 0x0020           // Alert status; ALRT pin stays low until cleared
+#define MAX17048_CONFIG_ATHD_MASK 0x001F      // Empty alert at (32 - ATHD)% SOC
+
+#define MAX17048_MODEL_UNLOCK_KEY 0x4A57
+#define MAX17048_MODEL_TABLE_SIZE 64
+#define MAX17048_RCOMPSEG_WORDS 16
+
+// Register LSB weights
+#define MAX17048_VCELL_LSB_V 0.000078125f     // 78.125uV per cell (156.25uV per pair on the MAX17049)
+#define MAX17048_SOC_LSB_PCT (1.0f / 256.0f)  // 1/256 %
+#define MAX17048_CRATE_LSB_PCT_HR 0.208f      // 0.208 %/hr
+
+/**
+ * @brief VCELL in microvolts, integer only.
+ *
+ * 78.125 uV = 625/8 uV, so the result is the exact value rounded down (error < 0.125 uV).
+ */
+static inline uint32_t max17048_regs_vcell_uv(uint16_t vcell)
+{
+    return ((uint32_t)vcell * 625) >> 3;
+}
+
+/**
+ * @brief Voltage across the measured stack in microvolts, integer only.
+ *
+ * The MAX17049 reports the two-cell stack with twice the LSB weight, so this
+ * is max17048_regs_vcell_uv() scaled by the cell count. With the variant
+ * pinned (CONFIG_MAX17048_VARIANT_*, or MAX17048_FIXED_VARIANT on the host)
+ * the scale folds into a constant and the argument is ignored.
+ */
+static inline uint32_t max17048_regs_vcell_stack_uv(uint16_t vcell, max17048_variant_t variant)
+{
+#ifdef MAX17048_FIXED_VARIANT
+    variant = MAX17048_FIXED_VARIANT;
+#endif
+    return ((uint32_t)vcell * 625 * (uint32_t)variant) >> 3;
+}
+
+/**
+ * @brief SOC in 0.001 %, integer only.
+ *
+ * 1/256 % = 125/32 m%, rounded down (error < 1/32 m%).
+ */
+static inline uint32_t max17048_regs_soc_mpct(uint16_t soc)
+{
+    return ((uint32_t)soc * 125) >> 5;
+}
+
+/**
+ * @brief CRATE in 0.001 %/hr, integer only and exact (0.208 %/hr = 208 m%/hr).
+ */
+static inline int32_t max17048_regs_crate_mpct_hr(int16_t crate)
+{
+    return (int32_t)crate * 208;
+}
+
+/**
+ * @brief Stack voltage in volts, the float expression behind max17048_get_voltage().
+ */
+static inline float max17048_regs_vcell_v(uint16_t vcell, max17048_variant_t variant)
+{
+#ifdef MAX17048_FIXED_VARIANT
+    variant = MAX17048_FIXED_VARIANT;
+#endif
+    return vcell * MAX17048_VCELL_LSB_V * (float)variant;
+}
+
+/**
+ * @brief SOC in percent, the float expression behind max17048_get_soc() (exact).
+ */
+static inline float max17048_regs_soc_pct(uint16_t soc)
+{
+    return (soc >> 8) + ((soc & 0xFF) / 256.0f);
+}
+
+/**
+ * @brief CRATE in %/hr, the float expression behind max17048_get_crate().
+ */
+static inline float max17048_regs_crate_pct_hr(int16_t crate)
+{
+    return crate * MAX17048_CRATE_LSB_PCT_HR;
+}
+
+/**
+ * @brief Decode the VCELL+SOC burst (4 bytes from MAX17048_VCELL_REG) into a snapshot.
+ */
+static inline void max17048_regs_decode_vcell_soc(const uint8_t buf[4], max17048_snapshot_t *snapshot)
+{
+    snapshot->vcell = (uint16_t)((buf[0] << 8) | buf[1]);
+    snapshot->soc = (uint16_t)((buf[2] << 8) | buf[3]);
+}
+
+/**
+ * @brief Decode the CRATE register (2 bytes from MAX17048_CRATE_REG) into a snapshot.
+ */
+static inline void max17048_regs_decode_crate(const uint8_t buf[2], max17048_snapshot_t *snapshot)
+{
+    snapshot->crate = (int16_t)((buf[0] << 8) | buf[1]);
+}
+
+#endif // MAX17048_REGS_H
@@ -0,0 +1,120 @@
+#ifndef MAX17048_RULES_H
+#define MAX17048_RULES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "max17048.h"
+
+/**
+ * @brief Maximum number of ANDed conditions per rule
+ */
+#define MAX17048_RULE_MAX_CONDS 4
+
+/**
+ * @brief Condition comparison operators
+ */
+typedef enum {
+    MAX17048_RULE_LT,                         // field <  threshold
+    MAX17048_RULE_LE,                         // field <= threshold
+    MAX17048_RULE_GT,                         // field >  threshold
+    MAX17048_RULE_GE,                         // field >= threshold
+} max17048_rule_op_t;
+
+/**
+ * @brief One condition in physical units
+ */
+typedef struct {
+    max17048_field_t field;                   // Snapshot field to test
+    max17048_rule_op_t op;                    // Comparison
+    float threshold;                          // V for VCELL, % for SOC, %/hr for CRATE
+} max17048_rule_cond_t;
+
+/**
+ * @brief Called when a rule becomes active (conditions held for hold_ms) or clears again
+ */
+typedef void (*max17048_rule_cb_t)(size_t rule_index, bool active, const max17048_snapshot_t *snapshot, void *user_ctx);
+
+/**
+ * @brief Rule definition, compiled once by max17048_rules_add()
+ *
+ * Example: "SOC < 15% and discharging faster than 5%/hr for 60 s" is
+ * { {SOC, LT, 15}, {CRATE, LT, -5} } with hold_ms = 60000.
+ */
+typedef struct {
+    max17048_rule_cond_t conds[MAX17048_RULE_MAX_CONDS]; // Conditions, all must hold
+    size_t num_conds;                         // Number of conditions (1..MAX17048_RULE_MAX_CONDS)
+    uint32_t hold_ms;                         // How long the conditions must hold before firing
+    max17048_rule_cb_t cb;                    // Callback on activation and on clearing
+    void *user_ctx;                           // Passed through to cb
+} max17048_rule_def_t;
+
+/**
+ * @brief Compiled rule with its evaluation state
+ *
+ * Thresholds are pre-scaled to raw register units and every operator is
+ * reduced to "raw < t" or "raw >= t", so evaluation is integer compares only.
+ */
+typedef struct {
+    int32_t threshold[MAX17048_RULE_MAX_CONDS];
+    uint8_t field[MAX17048_RULE_MAX_CONDS];
+    uint8_t below;                            // Bit n set: condition n is raw < t, else raw >= t
+    uint8_t num_conds;
+    bool active;                              // Callback fired and not cleared yet
+    bool holding;                             // Conditions currently true
+    int64_t hold_us;
+    int64_t since_us;                         // Timestamp the conditions became true
+    max17048_rule_cb_t cb;
+    void *user_ctx;
+} max17048_rule_t;
+
+/**
+ * @brief Rule engine over caller-provided rule storage
+ */
+typedef struct {
+    max17048_rule_t *rules;
+    size_t capacity;
+    size_t count;
+} max17048_rules_t;
+
+/**
+ * @brief Initialize a rule engine.
+ *
+ * @param engine Engine to initialize.
+ * @param storage Array of capacity rules, owned by the caller.
+ * @param capacity Number of entries in storage.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is NULL or capacity is 0
+ */
+esp_err_t max17048_rules_init(max17048_rules_t *engine, max17048_rule_t *storage, size_t capacity);
+
+/**
+ * @brief Compile a rule definition into the engine.
+ *
+ * @param engine Rule engine.
+ * @param def Rule definition.
+ * @param ret_index Optional pointer receiving the rule index passed to the callback.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the definition is invalid
+ *      - ESP_ERR_NO_MEM if the storage is full
+ */
+esp_err_t max17048_rules_add(max17048_rules_t *engine, const max17048_rule_def_t *def, size_t *ret_index);
+
+/**
+ * @brief Evaluate all rules against a new snapshot.
+ *
+ * Only the per-rule state is updated; callbacks fire on transitions.
+ *
+ * @param engine Rule engine.
+ * @param snapshot New snapshot.
+ */
+void max17048_rules_eval(max17048_rules_t *engine, const max17048_snapshot_t *snapshot);
+
+/**
+ * @brief Sampler listener adapter: max17048_sampler_add_listener(max17048_rules_sampler_cb, engine).
+ */
+void max17048_rules_sampler_cb(const max17048_snapshot_t *snapshot, void *engine);
+
+#endif // MAX17048_RULES_H
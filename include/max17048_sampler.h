@@ -0,0 +1,169 @@
+#ifndef MAX17048_SAMPLER_H
+#define MAX17048_SAMPLER_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "max17048.h"
+#include "max17048_filter.h"
+
+/**
+ * @brief Maximum number of sampler listeners
+ */
+#define MAX17048_SAMPLER_MAX_LISTENERS 8
+
+/**
+ * @brief Maximum number of raw (pre-filter) listeners, at most MAX17048_SAMPLER_MAX_LISTENERS
+ */
+#define MAX17048_SAMPLER_MAX_RAW_LISTENERS 4
+
+/**
+ * @brief Listener called from the sampler task with each delivered snapshot
+ */
+typedef void (*max17048_sampler_cb_t)(const max17048_snapshot_t *snapshot, void *user_ctx);
+
+/**
+ * @brief Sampler configuration structure
+ */
+typedef struct {
+    uint32_t period_ms;                       // Sampling period (default: 1000)
+    uint32_t task_stack_size;                 // Sampler task stack in bytes (default: 3072)
+    UBaseType_t task_priority;                // Sampler task priority (default: 5)
+    BaseType_t task_core_id;                  // Core to pin the task to (default: tskNO_AFFINITY)
+} max17048_sampler_config_t;
+
+/**
+ * @brief Get default configuration for the sampler.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_sampler_get_default_config(max17048_sampler_config_t *config);
+
+/**
+ * @brief Start periodic sampling of the initialized gauge.
+ *
+ * Each period the sampler reads a snapshot, runs the attached filters and
+ * hands the result to every listener.
+ *
+ * @param config Pointer to configuration structure.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if config is NULL or the period is 0
+ *      - ESP_ERR_INVALID_STATE if the sampler is already running
+ *      - ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t max17048_sampler_start(const max17048_sampler_config_t *config);
+
+/**
+ * @brief Stop the sampler and wait for its task to exit.
+ *
+ * Blocks on a semaphore of its own, so the caller's task notifications are
+ * left alone. The latest snapshot is discarded.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the sampler is not running or this is called from a listener
+ */
+esp_err_t max17048_sampler_stop(void);
+
+/**
+ * @brief Change the sampling period while running.
+ *
+ * Used by consumers that need to slow the sampler down, e.g. the uplink
+ * publisher under backpressure. Takes effect from the next period.
+ *
+ * @param period_ms New sampling period.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if period_ms is 0
+ */
+esp_err_t max17048_sampler_set_period_ms(uint32_t period_ms);
+
+/**
+ * @brief Get the current sampling period.
+ *
+ * @return Period in milliseconds (0 before the first start).
+ */
+uint32_t max17048_sampler_get_period_ms(void);
+
+/**
+ * @brief Register a listener for delivered snapshots.
+ *
+ * @param cb Callback, runs in the sampler task and must not block.
+ * @param user_ctx Passed through to cb.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if cb is NULL
+ *      - ESP_ERR_NO_MEM if all listener slots are used
+ */
+esp_err_t max17048_sampler_add_listener(max17048_sampler_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Unregister a listener.
+ *
+ * Waits for a dispatch in progress, so once this returns the callback is
+ * not running and will not be called again; its state can be freed.
+ *
+ * @param cb Callback given to max17048_sampler_add_listener().
+ * @param user_ctx Context given to max17048_sampler_add_listener().
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if the listener is not registered
+ *      - ESP_ERR_INVALID_STATE if called from a listener (it would wait on itself)
+ */
+esp_err_t max17048_sampler_remove_listener(max17048_sampler_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Register a listener for every raw snapshot, before the filters.
+ *
+ * Raw listeners see each successful read as it came off the bus, also the
+ * ones a decimator drops, and run before the filtered listeners.
+ *
+ * @param cb Callback, runs in the sampler task and must not block.
+ * @param user_ctx Passed through to cb.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if cb is NULL
+ *      - ESP_ERR_NO_MEM if all raw listener slots are used
+ */
+esp_err_t max17048_sampler_add_raw_listener(max17048_sampler_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Unregister a raw listener, with the same guarantees as max17048_sampler_remove_listener().
+ *
+ * @param cb Callback given to max17048_sampler_add_raw_listener().
+ * @param user_ctx Context given to max17048_sampler_add_raw_listener().
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if the listener is not registered
+ *      - ESP_ERR_INVALID_STATE if called from a listener
+ */
+esp_err_t max17048_sampler_remove_raw_listener(max17048_sampler_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Attach a filter pipeline to one snapshot field.
+ *
+ * The pipeline is owned by the caller and must stay valid while attached;
+ * once a detach returns the sampler no longer touches it.
+ * A snapshot is delivered only when every attached pipeline produced an
+ * output, so a decimator on one field thins out deliveries as a whole.
+ *
+ * @param field Field to filter.
+ * @param filter Initialized pipeline, or NULL to detach.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if field is out of range
+ */
+esp_err_t max17048_sampler_set_filter(max17048_field_t field, max17048_filter_t *filter);
+
+/**
+ * @brief Get the latest delivered snapshot without touching the bus.
+ *
+ * @param snapshot Pointer to a snapshot structure to fill.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if snapshot is NULL
+ *      - ESP_ERR_NOT_FOUND if nothing has been delivered yet
+ */
+esp_err_t max17048_sampler_get_latest(max17048_snapshot_t *snapshot);
+
+#endif // MAX17048_SAMPLER_H
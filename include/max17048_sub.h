@@ -0,0 +1,198 @@
+#ifndef MAX17048_SUB_H
+#define MAX17048_SUB_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "max17048_refresh.h"
+
+/**
+ * @brief Maximum number of concurrent subscriptions
+ */
+#define MAX17048_SUB_MAX 8
+
+/**
+ * @brief Field mask bit for a register, e.g. MAX17048_SUB_FIELD(MAX17048_REFRESH_SOC)
+ */
+#define MAX17048_SUB_FIELD(reg) ((uint16_t)(1u << (reg)))
+
+/**
+ * @brief Deadbands in raw register units from physical units
+ */
+#define MAX17048_SUB_DEADBAND_MV(mv) ((uint16_t)((mv) * 64 / 5))                  // VCELL, 78.125 uV LSB
+#define MAX17048_SUB_DEADBAND_SOC_MPCT(mpct) ((uint16_t)((mpct) * 256 / 1000))     // SOC, 0.001 % units
+#define MAX17048_SUB_DEADBAND_CRATE_MPCT_HR(mpct) ((uint16_t)((mpct) / 208))      // CRATE, 0.001 %/hr units
+
+/**
+ * @brief Battery state bits used by MAX17048_SUB_ON_STATE
+ *
+ * The high byte mirrors the STATUS alert flags (RI, VH, VL, VR, HD, SC, EnVR).
+ */
+#define MAX17048_SUB_STATE_CHARGING 0x0001    // CRATE above +crate_idle
+#define MAX17048_SUB_STATE_DISCHARGING 0x0002 // CRATE below -crate_idle
+#define MAX17048_SUB_STATE_ALERTS 0xFF00
+
+/**
+ * @brief When a subscriber is woken
+ */
+typedef enum {
+    MAX17048_SUB_PERIODIC,                    // Every max_staleness_ms
+    MAX17048_SUB_ON_CHANGE,                   // Only when a field moved past its deadband
+    MAX17048_SUB_ON_STATE,                    // Only when the battery state changed
+} max17048_sub_mode_t;
+
+/**
+ * @brief Values delivered to one subscriber
+ */
+typedef struct {
+    uint16_t fields;                          // Subscribed fields, all present in value[]
+    uint16_t changed;                         // Fields that moved past their deadband since the last delivery
+    uint16_t state;                           // MAX17048_SUB_STATE_* from the subscribed CRATE/STATUS
+    uint16_t value[MAX17048_REFRESH_REG_MAX]; // Raw register values, valid for bits in fields
+    int64_t timestamp_us;                     // Time of this delivery
+} max17048_sub_update_t;
+
+/**
+ * @brief Subscriber callback, runs in the subscription task and must not block
+ */
+typedef void (*max17048_sub_cb_t)(const max17048_sub_update_t *update, void *user_ctx);
+
+/**
+ * @brief One consumer's requirements
+ *
+ * The merged schedule refreshes every field at the smallest staleness any
+ * subscriber asked for, so bus work follows the union of subscriptions.
+ * Deliveries go either to cb, or as a notification to notify_task: the
+ * bits are OR-ed into the task's notification value, so several updates
+ * before the task runs wake it once and it fetches the latest with
+ * max17048_sub_get_update().
+ */
+typedef struct {
+    uint16_t fields;                          // MAX17048_SUB_FIELD() mask
+    uint32_t max_staleness_ms;                // Check for changes at least this often
+    max17048_sub_mode_t mode;                 // Delivery filter
+    uint16_t deadband[MAX17048_REFRESH_REG_MAX]; // ON_CHANGE: raw units, a field changes when |delta| > deadband
+    uint16_t crate_idle;                      // ON_STATE: raw |CRATE| still counted as idle
+    max17048_sub_cb_t cb;                     // Callback, or NULL to notify a task
+    void *user_ctx;
+    TaskHandle_t notify_task;                 // Task to notify when cb is NULL
+    uint32_t notify_bits;                     // Bits set in its notification value
+} max17048_sub_config_t;
+
+/**
+ * @brief Per-subscription counters
+ */
+typedef struct {
+    uint32_t delivered;                       // Callbacks or notifications sent
+    uint32_t suppressed;                      // Due checks filtered out by deadband or state
+    uint32_t coalesced;                       // Notifications merged into one not yet fetched
+} max17048_sub_counters_t;
+
+/**
+ * @brief Subscription service configuration structure
+ */
+typedef struct {
+    uint32_t task_stack_size;                 // Service task stack in bytes (default: 3072)
+    UBaseType_t task_priority;                // Service task priority (default: 5)
+} max17048_sub_service_config_t;
+
+/**
+ * @brief Subscription service statistics
+ */
+typedef struct {
+    max17048_refresh_stats_t refresh;         // Bus work of the merged schedule
+    uint32_t deliveries;                      // Callbacks invoked and notifications sent
+    uint32_t suppressed;                      // Deliveries filtered out across all subscribers
+    uint32_t read_errors;                     // Failed refresh ticks
+} max17048_sub_stats_t;
+
+/**
+ * @brief Get default configuration for the subscription service.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_sub_get_default_config(max17048_sub_service_config_t *config);
+
+/**
+ * @brief Start the subscription service task.
+ *
+ * @param config Pointer to configuration structure.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if config is NULL
+ *      - ESP_ERR_INVALID_STATE if already running
+ *      - ESP_ERR_NO_MEM if the task cannot be created
+ */
+esp_err_t max17048_sub_start(const max17048_sub_service_config_t *config);
+
+/**
+ * @brief Stop the subscription service. Subscriptions are kept.
+ *
+ * Returns once the service task has exited.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if not running, or called from a subscriber callback
+ */
+esp_err_t max17048_sub_stop(void);
+
+/**
+ * @brief Add a subscription; the merged schedule is recomputed immediately.
+ *
+ * @param config Subscription.
+ * @param ret_id Returned subscription id.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if fields is 0, max_staleness_ms is 0 or neither cb nor notify_task is set
+ *      - ESP_ERR_NO_MEM if all subscription slots are used
+ */
+esp_err_t max17048_sub_subscribe(const max17048_sub_config_t *config, int *ret_id);
+
+/**
+ * @brief Remove a subscription. A delivery already in progress may still complete.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_NOT_FOUND if id is not subscribed
+ */
+esp_err_t max17048_sub_unsubscribe(int id);
+
+/**
+ * @brief Fetch the latest update of a subscription, e.g. after a notification.
+ *
+ * @param id Subscription id.
+ * @param update Latest delivered update.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if update is NULL
+ *      - ESP_ERR_NOT_FOUND if id is not subscribed or nothing was delivered yet
+ */
+esp_err_t max17048_sub_get_update(int id, max17048_sub_update_t *update);
+
+/**
+ * @brief Get the counters of one subscription.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if counters is NULL
+ *      - ESP_ERR_NOT_FOUND if id is not subscribed
+ */
+esp_err_t max17048_sub_get_counters(int id, max17048_sub_counters_t *counters);
+
+/**
+ * @brief Get the merged refresh interval of every register (0 = not refreshed).
+ *
+ * @param interval_ms Output, indexed by max17048_refresh_reg_t.
+ */
+void max17048_sub_get_schedule(uint32_t interval_ms[MAX17048_REFRESH_REG_MAX]);
+
+/**
+ * @brief Get subscription service statistics.
+ *
+ * @param stats Pointer to a statistics structure to fill.
+ */
+void max17048_sub_get_stats(max17048_sub_stats_t *stats);
+
+#endif // MAX17048_SUB_H
@@ -0,0 +1,88 @@
+#ifndef MAX17048_THERMAL_H
+#define MAX17048_THERMAL_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "max17048_model.h"
+
+/**
+ * @brief Where the ambient temperature comes from
+ */
+typedef enum {
+    MAX17048_THERMAL_AMBIENT_FIXED,           // ambient_dc, updated by max17048_thermal_set_ambient()
+    MAX17048_THERMAL_AMBIENT_CHIP,            // ESP internal temperature sensor plus chip_offset_dc
+} max17048_thermal_ambient_t;
+
+/**
+ * @brief Thermal estimator configuration structure
+ *
+ * The cell is modelled as a single thermal mass: it relaxes towards
+ * ambient + I^2 * R * theta with the given time constant.
+ */
+typedef struct {
+    uint32_t capacity_mah;                    // Cell capacity, converts CRATE to current
+    uint16_t resistance_mohm;                 // Cell internal resistance (default: 150)
+    uint16_t theta_dc_per_w;                  // Cell-to-ambient thermal resistance, 0.1 C/W (default: 300)
+    uint32_t tau_s;                           // Thermal time constant (default: 600)
+    max17048_thermal_ambient_t ambient;       // Ambient source (default: FIXED)
+    int32_t ambient_dc;                       // Fixed ambient in FIXED mode, 0.1 C (default: 200)
+    int32_t chip_offset_dc;                   // Added to the chip sensor in CHIP mode, 0.1 C (default: 0)
+    const max17048_model_t *model;            // RCOMP0 and temperature coefficients; NULL for the stock model
+    uint8_t rcomp_deadband;                   // RCOMP is rewritten only when it moves more than this (default: 0)
+    uint32_t task_stack_size;                 // Stack of the task writing RCOMP (default: 2560)
+    uint8_t task_priority;                    // Its priority (default: 4)
+} max17048_thermal_config_t;
+
+/**
+ * @brief Get default configuration for the thermal estimator.
+ *
+ * @param config Pointer to configuration structure to fill with defaults.
+ */
+void max17048_thermal_get_default_config(max17048_thermal_config_t *config);
+
+/**
+ * @brief Start estimating cell temperature and compensating RCOMP.
+ *
+ * The estimate runs in fixed point as a sampler listener; the sampler must
+ * deliver CRATE. RCOMP follows the estimate through max17048_set_rcomp()
+ * on a small task of its own, which also reads the chip sensor in CHIP
+ * mode, so the sampler task never blocks on the bus or the sensor.
+ *
+ * @param config Pointer to configuration structure.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *      - ESP_ERR_INVALID_STATE if already running
+ *      - ESP_ERR_NOT_SUPPORTED if the chip has no temperature sensor
+ *      - ESP_ERR_NO_MEM if the task or the listener cannot be created
+ */
+esp_err_t max17048_thermal_start(const max17048_thermal_config_t *config);
+
+/**
+ * @brief Stop the estimator. RCOMP keeps its last value.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if not running, or called from a sampler listener
+ */
+esp_err_t max17048_thermal_stop(void);
+
+/**
+ * @brief Update the ambient hint: the fixed ambient in FIXED mode, the chip sensor offset in CHIP mode.
+ *
+ * @param ambient_dc Temperature or offset in 0.1 degrees C.
+ */
+void max17048_thermal_set_ambient(int32_t ambient_dc);
+
+/**
+ * @brief Get the estimated cell temperature.
+ *
+ * @param temp_dc Estimated temperature in 0.1 degrees C.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if temp_dc is NULL
+ *      - ESP_ERR_NOT_FOUND if no snapshot has been processed yet
+ */
+esp_err_t max17048_thermal_get_temp(int32_t *temp_dc);
+
+#endif // MAX17048_THERMAL_H
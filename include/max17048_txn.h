@@ -0,0 +1,117 @@
+#ifndef MAX17048_TXN_H
+#define MAX17048_TXN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+
+/**
+ * @brief Upper bounds of one transaction group
+ */
+#define MAX17048_TXN_MAX_STEPS 6
+#define MAX17048_TXN_MAX_WRITE 8              // Bytes per write step, copied into the group
+
+/**
+ * @brief Step kinds
+ */
+typedef enum {
+    MAX17048_TXN_WRITE,                       // START, address+W, data, STOP
+    MAX17048_TXN_READ,                        // START, address+W, register, repeated START, address+R, data, STOP
+} max17048_txn_kind_t;
+
+/**
+ * @brief One step of a transaction group
+ */
+typedef struct {
+    max17048_txn_kind_t kind;
+    i2c_master_dev_handle_t dev;              // Device handle (used when the bus cannot run the group in one go)
+    uint8_t tx[MAX17048_TXN_MAX_WRITE + 1];   // Address byte followed by the data or register
+    uint8_t tx_len;                           // Including the address byte
+    uint8_t rx_addr;                          // Address+R byte of a read
+    uint8_t *rx;
+    uint8_t rx_len;
+} max17048_txn_step_t;
+
+/**
+ * @brief Transaction group in caller storage
+ *
+ * Steps may address different devices (e.g. an I2C mux and the gauge) but
+ * must all sit on the same bus. Every step ends with a STOP, so mux channel
+ * changes take effect before the next step.
+ */
+typedef struct {
+    max17048_txn_step_t steps[MAX17048_TXN_MAX_STEPS];
+    size_t count;
+} max17048_txn_t;
+
+/**
+ * @brief Start an empty group.
+ */
+void max17048_txn_init(max17048_txn_t *txn);
+
+/**
+ * @brief Append a write, e.g. a mux channel select.
+ *
+ * @param txn Group.
+ * @param dev Device handle.
+ * @param address 7-bit device address (the address dev was created with).
+ * @param data Bytes to write, copied.
+ * @param len Number of bytes (1..MAX17048_TXN_MAX_WRITE).
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is invalid
+ *      - ESP_ERR_NO_MEM if the group is full
+ */
+esp_err_t max17048_txn_add_write(max17048_txn_t *txn, i2c_master_dev_handle_t dev, uint8_t address, const uint8_t *data,
+                                 size_t len);
+
+/**
+ * @brief Append a register read.
+ *
+ * @param txn Group.
+ * @param dev Device handle.
+ * @param address 7-bit device address.
+ * @param reg First register.
+ * @param rx Destination, must stay valid until max17048_txn_execute() returns.
+ * @param len Number of bytes (1..255).
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if an argument is invalid
+ *      - ESP_ERR_NO_MEM if the group is full
+ */
+esp_err_t max17048_txn_add_read(max17048_txn_t *txn, i2c_master_dev_handle_t dev, uint8_t address, uint8_t reg,
+                                uint8_t *rx, size_t len);
+
+/**
+ * @brief Append a register read from the initialized gauge.
+ *
+ * @return Same as max17048_txn_add_read(), or ESP_ERR_INVALID_STATE if the driver is not initialized.
+ */
+esp_err_t max17048_txn_add_gauge_read(max17048_txn_t *txn, uint8_t reg, uint8_t *rx, size_t len);
+
+/**
+ * @brief Append a 16-bit register write to the initialized gauge, e.g. clearing STATUS.
+ *
+ * @return Same as max17048_txn_add_write(), or ESP_ERR_INVALID_STATE if the driver is not initialized.
+ */
+esp_err_t max17048_txn_add_gauge_write_word(max17048_txn_t *txn, uint8_t reg, uint16_t value);
+
+/**
+ * @brief Run all steps back-to-back while holding the bus.
+ *
+ * With ESP-IDF 5.5 or later the whole group is a single
+ * i2c_master_execute_defined_operations() call: one bus lock and one queue
+ * round trip, with no other device interleaved. On older versions the steps
+ * run one by one and the group only excludes other transaction groups.
+ *
+ * @param txn Group.
+ * @param timeout_ms Timeout for the whole group.
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_ARG if txn is NULL or empty
+ *      - ESP_FAIL or ESP_ERR_TIMEOUT if a step fails (later steps are not run)
+ */
+esp_err_t max17048_txn_execute(max17048_txn_t *txn, uint32_t timeout_ms);
+
+#endif // MAX17048_TXN_H
@@ -0,0 +1,58 @@
+#ifndef MAX17048_TYPES_H
+#define MAX17048_TYPES_H
+
+#include <stdint.h>
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+// Plain data types shared with the platform-independent modules and host tools
+
+/**
+ * @brief Raw register snapshot of one gauge
+ *
+ * Values are kept in register units so that sampling stays free of float math.
+ * Scale with the LSB weight of each field when a physical value is needed.
+ */
+typedef struct {
+    uint16_t vcell;                           // VCELL register (LSB = 78.125uV per cell)
+    uint16_t soc;                             // SOC register (LSB = 1/256%)
+    int16_t crate;                            // CRATE register (LSB = 0.208%/hr)
+    int64_t timestamp_us;                     // esp_timer time the VCELL/SOC burst completed
+} max17048_snapshot_t;
+
+/**
+ * @brief Gauge variant; the value is the number of series cells VCELL measures
+ *
+ * The two parts share the register map and report the same VERSION, so the
+ * variant cannot be read back from the IC and has to be configured.
+ */
+typedef enum {
+    MAX17048_VARIANT_MAX17048 = 1,            // Single cell, VCELL LSB 78.125uV
+    MAX17048_VARIANT_MAX17049 = 2,            // Two cells in series, VCELL LSB 156.25uV
+} max17048_variant_t;
+
+// Variant pinned at build time. In ESP-IDF builds it comes from Kconfig only, so the
+// component and every consumer see the same value; host tools may define it directly.
+#ifdef ESP_PLATFORM
+#ifdef MAX17048_FIXED_VARIANT
+#error "Pin the gauge variant with CONFIG_MAX17048_VARIANT_* (menuconfig), not MAX17048_FIXED_VARIANT"
+#endif
+#if CONFIG_MAX17048_VARIANT_MAX17048
+#define MAX17048_FIXED_VARIANT MAX17048_VARIANT_MAX17048
+#elif CONFIG_MAX17048_VARIANT_MAX17049
+#define MAX17048_FIXED_VARIANT MAX17048_VARIANT_MAX17049
+#endif
+#endif
+
+/**
+ * @brief Snapshot fields, used to attach per-field processing
+ */
+typedef enum {
+    MAX17048_FIELD_VCELL,
+    MAX17048_FIELD_SOC,
+    MAX17048_FIELD_CRATE,
+    MAX17048_FIELD_MAX,
+} max17048_field_t;
+
+#endif // MAX17048_TYPES_H
@@ -1,23 +1,46 @@
 #include <stdio.h>
+#include <string.h>
 #include "max17048.h"
+#include "max17048_priv.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
 
 static const char *TAG = "MAX17048_COMP";
 
-// Register Addresses
-#define MAX17048_VCELL_REG 0x02
-#define MAX17048_SOC_REG 0x04
-#define MAX17048_VERSION_REG 0x08
-#define MAX17048_CRATE_REG 0x16
-#define MAX17048_CMD_REG 0xFE
-
 // Global variables
 static i2c_master_dev_handle_t i2c_dev_handle = NULL;
 static bool is_initialized = false;
 static max17048_config_t current_config;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_stats_t stats;
+
+const uint32_t max17048_stats_latency_bounds_us[MAX17048_STATS_LATENCY_BUCKETS - 1] = {
+    100, 200, 500, 1000, 2000, 5000, 10000,
+};
 
 // --- Internal Helper Functions ---
+void max17048_stats_record(esp_err_t ret, int64_t start_us)
+{
+    uint32_t latency_us = (uint32_t)(esp_timer_get_time() - start_us);
+    int bucket = 0;
+    while (bucket < MAX17048_STATS_LATENCY_BUCKETS - 1 && latency_us > max17048_stats_latency_bounds_us[bucket])
+    {
+        bucket++;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.transactions++;
+    if (ret != ESP_OK)
+    {
+        stats.errors++;
+    }
+    stats.latency_sum_us += latency_us;
+    stats.latency_buckets[bucket]++;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
 static esp_err_t max17048_write_word(uint8_t reg_addr, uint16_t data)
 {
     if (!is_initialized || i2c_dev_handle == NULL) {
@@ -26,7 +49,10 @@ static esp_err_t max17048_write_word(uint8_t reg_addr, uint16_t data)
     
     uint8_t write_buf[3] = {reg_addr, (data >> 8) & 0xFF, data & 0xFF};
     uint32_t timeout_ms = current_config.i2c_timeout_ms;
-    return i2c_master_transmit(i2c_dev_handle, write_buf, sizeof(write_buf), timeout_ms);
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit(i2c_dev_handle, write_buf, sizeof(write_buf), timeout_ms);
+    max17048_stats_record(ret, start_us);
+    return ret;
 }
 
 static esp_err_t max17048_read_word(uint8_t reg_addr, uint16_t *data)
@@ -37,7 +63,7 @@ static esp_err_t max17048_read_word(uint8_t reg_addr, uint16_t *data)
     
     uint8_t read_buf[2];
     uint32_t timeout_ms = current_config.i2c_timeout_ms;
-    esp_err_t ret = i2c_master_transmit_receive(i2c_dev_handle, &reg_addr, 1, read_buf, 2, timeout_ms);
+    esp_err_t ret = max17048_i2c_read_regs(i2c_dev_handle, reg_addr, read_buf, sizeof(read_buf), timeout_ms);
     if (ret == ESP_OK)
     {
         *data = (read_buf[0] << 8) | read_buf[1];
@@ -45,6 +71,106 @@ static esp_err_t max17048_read_word(uint8_t reg_addr, uint16_t *data)
     return ret;
 }
 
+// --- Component-internal Functions (max17048_priv.h) ---
+
+esp_err_t max17048_i2c_read_regs(i2c_master_dev_handle_t dev, uint8_t reg_addr, uint8_t *data, size_t len, uint32_t timeout_ms)
+{
+    // The register pointer auto-increments, so adjacent registers come back in one transaction
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit_receive(dev, &reg_addr, 1, data, len, timeout_ms);
+    max17048_stats_record(ret, start_us);
+    return ret;
+}
+
+esp_err_t max17048_read_register(uint8_t reg_addr, uint16_t *value)
+{
+    return max17048_read_word(reg_addr, value);
+}
+
+esp_err_t max17048_read_burst(uint8_t reg_addr, uint8_t *data, size_t len)
+{
+    if (!is_initialized || i2c_dev_handle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return max17048_i2c_read_regs(i2c_dev_handle, reg_addr, data, len, current_config.i2c_timeout_ms);
+}
+
+esp_err_t max17048_write_burst(uint8_t reg_addr, const uint8_t *data, size_t len)
+{
+    if (!is_initialized || i2c_dev_handle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (len > MAX17048_WRITE_BURST_MAX)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Register pointer first; it auto-increments across the data like a burst read
+    uint8_t write_buf[1 + MAX17048_WRITE_BURST_MAX];
+    write_buf[0] = reg_addr;
+    memcpy(&write_buf[1], data, len);
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit(i2c_dev_handle, write_buf, 1 + len, current_config.i2c_timeout_ms);
+    max17048_stats_record(ret, start_us);
+    return ret;
+}
+
+esp_err_t max17048_get_device(i2c_master_dev_handle_t *dev, uint8_t *address)
+{
+    if (!is_initialized || i2c_dev_handle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *dev = i2c_dev_handle;
+    *address = (uint8_t)current_config.device_address;
+    return ESP_OK;
+}
+
+esp_err_t max17048_write_register(uint8_t reg_addr, uint16_t value)
+{
+    return max17048_write_word(reg_addr, value);
+}
+
+void max17048_stats_cache_access(bool hit)
+{
+    portENTER_CRITICAL(&stats_lock);
+    if (hit)
+    {
+        stats.cache_hits++;
+    }
+    else
+    {
+        stats.cache_misses++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+esp_err_t max17048_i2c_read_snapshot(i2c_master_dev_handle_t dev, uint32_t timeout_ms, bool read_crate, max17048_snapshot_t *snapshot)
+{
+    // VCELL (0x02) and SOC (0x04) are adjacent: one 4-byte burst covers both
+    uint8_t buf[4];
+    esp_err_t ret = max17048_i2c_read_regs(dev, MAX17048_VCELL_REG, buf, sizeof(buf), timeout_ms);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    snapshot->timestamp_us = esp_timer_get_time();
+    max17048_regs_decode_vcell_soc(buf, snapshot);
+    snapshot->crate = 0;
+
+    if (read_crate)
+    {
+        ret = max17048_i2c_read_regs(dev, MAX17048_CRATE_REG, buf, 2, timeout_ms);
+        if (ret == ESP_OK)
+        {
+            max17048_regs_decode_crate(buf, snapshot);
+        }
+    }
+    return ret;
+}
+
 // --- Public API Functions ---
 
 void max17048_get_default_config(max17048_config_t *config)
@@ -58,6 +184,11 @@ void max17048_get_default_config(max17048_config_t *config)
     config->device_address = 0x36;  // MAX17048 I2C address
     config->i2c_freq_hz = 100000;   // 100kHz frequency
     config->i2c_timeout_ms = 1000;  // 1000ms timeout
+#ifdef MAX17048_FIXED_VARIANT
+    config->variant = MAX17048_FIXED_VARIANT;
+#else
+    config->variant = MAX17048_VARIANT_MAX17048;
+#endif
 }
 
 esp_err_t max17048_init_with_config(const max17048_config_t *config)
@@ -68,6 +199,21 @@ esp_err_t max17048_init_with_config(const max17048_config_t *config)
         return ESP_ERR_INVALID_ARG;
     }
 
+    // A zeroed field (config built without max17048_get_default_config) means the single-cell part
+    max17048_variant_t variant = config->variant == 0 ? MAX17048_VARIANT_MAX17048 : config->variant;
+    if (variant != MAX17048_VARIANT_MAX17048 && variant != MAX17048_VARIANT_MAX17049)
+    {
+        ESP_LOGE(TAG, "Unknown gauge variant %d", (int)variant);
+        return ESP_ERR_INVALID_ARG;
+    }
+#ifdef MAX17048_FIXED_VARIANT
+    if (variant != MAX17048_FIXED_VARIANT)
+    {
+        ESP_LOGE(TAG, "Variant %d does not match CONFIG_MAX17048_VARIANT", (int)variant);
+        return ESP_ERR_INVALID_ARG;
+    }
+#endif
+
     if (is_initialized)
     {
         ESP_LOGW(TAG, "MAX17048 already initialized.");
@@ -76,6 +222,7 @@ esp_err_t max17048_init_with_config(const max17048_config_t *config)
 
     // Store configuration
     current_config = *config;
+    current_config.variant = variant;
 
     // Create I2C device handle
     i2c_device_config_t dev_cfg = {
@@ -141,7 +288,7 @@ esp_err_t max17048_get_soc(float *soc)
     esp_err_t ret = max17048_read_word(MAX17048_SOC_REG, &raw_soc);
     if (ret == ESP_OK)
     {
-        *soc = (raw_soc >> 8) + ((raw_soc & 0xFF) / 256.0f);
+        *soc = max17048_regs_soc_pct(raw_soc);
     }
     return ret;
 }
@@ -152,7 +299,7 @@ esp_err_t max17048_get_voltage(float *voltage)
     esp_err_t ret = max17048_read_word(MAX17048_VCELL_REG, &raw_voltage);
     if (ret == ESP_OK)
     {
-        *voltage = raw_voltage * 0.000078125f; // LSB = 78.125uV
+        *voltage = max17048_regs_vcell_v(raw_voltage, max17048_get_variant());
     }
     return ret;
 }
@@ -163,12 +310,91 @@ esp_err_t max17048_get_crate(float *crate)
     esp_err_t ret = max17048_read_word(MAX17048_CRATE_REG, &raw_crate);
     if (ret == ESP_OK)
     {
-        int16_t signed_crate = (int16_t)raw_crate;
-        *crate = signed_crate * 0.208f; // LSB = 0.208%/hr
+        *crate = max17048_regs_crate_pct_hr((int16_t)raw_crate);
+    }
+    return ret;
+}
+
+esp_err_t max17048_read_snapshot(max17048_snapshot_t *snapshot)
+{
+    if (snapshot == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!is_initialized || i2c_dev_handle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return max17048_i2c_read_snapshot(i2c_dev_handle, current_config.i2c_timeout_ms, true, snapshot);
+}
+
+uint32_t max17048_tte_seconds(uint16_t soc, int16_t crate)
+{
+    if (crate >= 0)
+    {
+        return MAX17048_TTE_INFINITE;
+    }
+    // (soc / 256 %) / (-crate * 0.208 %/hr) * 3600 s/hr, kept in integers
+    uint64_t tte = (uint64_t)soc * 3600000u / (53248u * (uint32_t)(-(int32_t)crate));
+    return tte >= MAX17048_TTE_INFINITE ? MAX17048_TTE_INFINITE - 1 : (uint32_t)tte;
+}
+
+esp_err_t max17048_get_stats(max17048_stats_t *out)
+{
+    if (out == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    return ESP_OK;
+}
+
+void max17048_reset_stats(void)
+{
+    portENTER_CRITICAL(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+esp_err_t max17048_set_rcomp(uint8_t rcomp)
+{
+    // Keep the alert configuration in the low byte of CONFIG
+    uint16_t config;
+    esp_err_t ret = max17048_read_word(MAX17048_CONFIG_REG, &config);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    return max17048_write_word(MAX17048_CONFIG_REG, (uint16_t)((rcomp << 8) | (config & 0xFF)));
+}
+
+esp_err_t max17048_get_rcomp(uint8_t *rcomp)
+{
+    if (rcomp == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t config;
+    esp_err_t ret = max17048_read_word(MAX17048_CONFIG_REG, &config);
+    if (ret == ESP_OK)
+    {
+        *rcomp = config >> 8;
     }
     return ret;
 }
 
+#ifndef MAX17048_FIXED_VARIANT
+max17048_variant_t max17048_get_variant(void)
+{
+    // Before init the config is zeroed; report the single-cell part
+    return current_config.variant == 0 ? MAX17048_VARIANT_MAX17048 : current_config.variant;
+}
+#endif
+
 esp_err_t max17048_get_version(uint16_t *version)
 {
     return max17048_read_word(MAX17048_VERSION_REG, version);
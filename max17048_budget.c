@@ -0,0 +1,341 @@
+#include <sys/time.h>
+#include "max17048_budget.h"
+#include "max17048_sampler.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "MAX17048_BUDGET";
+
+#define MAX17048_BUDGET_FACTOR_ONE 256        // Q8 cost factor of 1.0
+#define MAX17048_BUDGET_FACTOR_MIN 32         // Cost factor floor (1/8): settlements that saw no drain cannot make a class free
+#define MAX17048_BUDGET_MIN_SETTLE_SOC 4      // Raw SOC drop needed before a settlement teaches anything
+#define MAX17048_BUDGET_RTC_MAGIC 0x4D424447  // "MBDG"
+
+/**
+ * @brief Service deadline kept across resets
+ *
+ * Wall-clock time from gettimeofday(), whose RTC timer keeps running
+ * through software, panic and watchdog resets and deep sleep. A power-on
+ * reset leaves garbage that fails the check.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t service_interval_h;              // Interval the deadline was set for
+    int64_t deadline_wall_us;
+    uint32_t check;                           // Folded copy of the fields above
+} max17048_budget_rtc_t;
+
+// Global variables
+static RTC_NOINIT_ATTR max17048_budget_rtc_t s_rtc;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_budget_config_t s_config;
+static bool s_running = false;
+static bool s_has_soc = false;
+static uint16_t s_soc;                        // Latest raw SOC
+static bool s_has_crate = false;              // CRATE has been read: drain comes from it rather than SOC steps
+static uint64_t s_drain_nah;                  // Discharge integrated from CRATE, nAh
+static int64_t s_last_us;
+static int64_t s_deadline_us;
+static uint32_t s_window;                     // Current window number
+static int64_t s_window_start_us;
+static uint16_t s_window_start_soc;
+static uint64_t s_window_start_drain_nah;
+static uint32_t s_available_uah;
+static uint32_t s_settled_uah;                // Observed consumption settled in the current window
+static uint32_t s_baseline_uah;               // Learned drain per window outside any reservation
+static uint32_t s_cost_factor[MAX17048_BUDGET_MAX_CLASSES] = {
+    [0 ... MAX17048_BUDGET_MAX_CLASSES - 1] = MAX17048_BUDGET_FACTOR_ONE,
+};
+
+// --- Internal Helper Functions ---
+
+static int64_t max17048_budget_wall_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint32_t max17048_budget_rtc_check(void)
+{
+    return ~(s_rtc.magic ^ s_rtc.service_interval_h ^ (uint32_t)s_rtc.deadline_wall_us ^
+             (uint32_t)((uint64_t)s_rtc.deadline_wall_us >> 32));
+}
+
+// Deadline in esp_timer time: the one left by an earlier boot, or a new one from now
+static int64_t max17048_budget_load_deadline(uint32_t service_interval_h, bool restart)
+{
+    int64_t wall_us = max17048_budget_wall_us();
+    int64_t interval_us = (int64_t)service_interval_h * 3600 * 1000000;
+
+    if (restart || s_rtc.magic != MAX17048_BUDGET_RTC_MAGIC || s_rtc.check != max17048_budget_rtc_check() ||
+        s_rtc.service_interval_h != service_interval_h || s_rtc.deadline_wall_us - wall_us > interval_us)
+    {
+        s_rtc.magic = MAX17048_BUDGET_RTC_MAGIC;
+        s_rtc.service_interval_h = service_interval_h;
+        s_rtc.deadline_wall_us = wall_us + interval_us;
+        s_rtc.check = max17048_budget_rtc_check();
+        ESP_LOGI(TAG, "New service interval of %lu h", (unsigned long)service_interval_h);
+    }
+    return esp_timer_get_time() + (s_rtc.deadline_wall_us - wall_us);
+}
+
+static uint32_t max17048_budget_soc_to_uah(int32_t soc_delta)
+{
+    if (soc_delta <= 0)
+    {
+        return 0;
+    }
+    // raw / 256 % of capacity_mah * 1000 uAh
+    return (uint32_t)((uint64_t)soc_delta * s_config.capacity_mah * 1000u / 25600u);
+}
+
+// Charge drained since the given counters, from CRATE once it has been read, else from SOC
+static uint32_t max17048_budget_drained_uah(uint16_t start_soc, uint64_t start_drain_nah)
+{
+    if (s_has_crate)
+    {
+        // A restart of the service resets the counter under an older ticket
+        return s_drain_nah > start_drain_nah ? (uint32_t)((s_drain_nah - start_drain_nah) / 1000) : 0;
+    }
+    return max17048_budget_soc_to_uah((int32_t)start_soc - (int32_t)s_soc);
+}
+
+// Called with s_lock held
+static void max17048_budget_open_window(int64_t now_us)
+{
+    int32_t reserve_raw = (int32_t)(s_config.reserve_soc * 256.0f);
+    uint32_t remaining_uah = max17048_budget_soc_to_uah((int32_t)s_soc - reserve_raw);
+
+    int64_t window_us = (int64_t)s_config.window_ms * 1000;
+    int64_t windows_left = (s_deadline_us - now_us) / window_us;
+    if (windows_left < 1)
+    {
+        windows_left = 1;
+    }
+
+    uint32_t allowance = (uint32_t)(remaining_uah / windows_left);
+    s_available_uah = allowance > s_baseline_uah ? allowance - s_baseline_uah : 0;
+    s_window_start_us = now_us;
+    s_window_start_soc = s_soc;
+    s_window_start_drain_nah = s_drain_nah;
+    s_settled_uah = 0;
+    s_window++;
+}
+
+static void max17048_budget_on_snapshot(const max17048_snapshot_t *snapshot, void *user_ctx)
+{
+    int64_t window_us = (int64_t)s_config.window_ms * 1000;
+
+    portENTER_CRITICAL(&s_lock);
+    s_soc = snapshot->soc;
+    if (snapshot->crate != 0)
+    {
+        s_has_crate = true;
+    }
+    if (s_has_soc && snapshot->crate < 0)
+    {
+        // CRATE 0.208 %/hr of capacity_mah = 2.08 uA per mAh; integrate over the interval it ends
+        uint64_t current_ua = (uint64_t)-snapshot->crate * 208 * s_config.capacity_mah / 100;
+        s_drain_nah += current_ua * (uint64_t)(snapshot->timestamp_us - s_last_us) / 3600000;
+    }
+    s_last_us = snapshot->timestamp_us;
+
+    if (!s_has_soc)
+    {
+        s_has_soc = true;
+        max17048_budget_open_window(snapshot->timestamp_us);
+    }
+    else if (snapshot->timestamp_us - s_window_start_us >= window_us)
+    {
+        // Whatever the window drained beyond settled reservations is baseline load
+        uint32_t drained = max17048_budget_drained_uah(s_window_start_soc, s_window_start_drain_nah);
+        uint32_t baseline = drained > s_settled_uah ? drained - s_settled_uah : 0;
+        s_baseline_uah = s_baseline_uah - (s_baseline_uah >> 2) + (baseline >> 2);
+        max17048_budget_open_window(snapshot->timestamp_us);
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// --- Public API Functions ---
+
+void max17048_budget_get_default_config(max17048_budget_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->capacity_mah = 0;       // Must be set by caller
+    config->service_interval_h = 0; // Must be set by caller
+    config->reserve_soc = 5.0f;
+    config->window_ms = 60000;      // 1 minute
+}
+
+esp_err_t max17048_budget_start(const max17048_budget_config_t *config)
+{
+    if (config == NULL || config->capacity_mah == 0 || config->service_interval_h == 0 || config->window_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t deadline_us = max17048_budget_load_deadline(config->service_interval_h, false);
+
+    portENTER_CRITICAL(&s_lock);
+    s_config = *config;
+    s_deadline_us = deadline_us;
+    s_has_soc = false;
+    s_has_crate = false;
+    s_drain_nah = 0;
+    s_window = 0;
+    s_available_uah = 0;
+    s_baseline_uah = 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    esp_err_t err = max17048_sampler_add_listener(max17048_budget_on_snapshot, NULL);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    s_running = true;
+    ESP_LOGI(TAG, "Energy budget started: %lu mAh over %lu h", (unsigned long)config->capacity_mah,
+             (unsigned long)config->service_interval_h);
+    return ESP_OK;
+}
+
+esp_err_t max17048_budget_stop(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = max17048_sampler_remove_listener(max17048_budget_on_snapshot, NULL);
+    if (err == ESP_OK)
+    {
+        s_running = false;
+    }
+    return err;
+}
+
+esp_err_t max17048_budget_restart_interval(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t deadline_us = max17048_budget_load_deadline(s_config.service_interval_h, true);
+    portENTER_CRITICAL(&s_lock);
+    s_deadline_us = deadline_us;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t max17048_budget_reserve(uint8_t cost_class, uint32_t estimate_uah, max17048_budget_ticket_t *ticket)
+{
+    if (cost_class >= MAX17048_BUDGET_MAX_CLASSES || ticket == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&s_lock);
+    if (!s_running || !s_has_soc)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        uint64_t reserved = (uint64_t)estimate_uah * s_cost_factor[cost_class] / MAX17048_BUDGET_FACTOR_ONE;
+        if (reserved > s_available_uah)
+        {
+            ret = ESP_ERR_NO_MEM;
+        }
+        else
+        {
+            s_available_uah -= (uint32_t)reserved;
+            ticket->cost_class = cost_class;
+            ticket->estimate_uah = estimate_uah;
+            ticket->reserved_uah = (uint32_t)reserved;
+            ticket->window = s_window;
+            ticket->start_soc = s_soc;
+            ticket->start_drain_nah = s_drain_nah;
+            ticket->start_us = esp_timer_get_time();
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+esp_err_t max17048_budget_settle(const max17048_budget_ticket_t *ticket)
+{
+    if (ticket == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t now_us = esp_timer_get_time();
+    esp_err_t ret = ESP_OK;
+    portENTER_CRITICAL(&s_lock);
+    if (!s_running)
+    {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    else
+    {
+        // Observed drain minus the baseline drain expected over the same time
+        int32_t soc_drop = (int32_t)ticket->start_soc - (int32_t)s_soc;
+        uint32_t drained = max17048_budget_drained_uah(ticket->start_soc, ticket->start_drain_nah);
+        uint64_t baseline = (uint64_t)s_baseline_uah * (uint64_t)(now_us - ticket->start_us) /
+                            ((uint64_t)s_config.window_ms * 1000);
+        uint32_t used = drained > baseline ? drained - (uint32_t)baseline : 0;
+
+        if (ticket->window == s_window)
+        {
+            s_settled_uah += used;
+            if (used < ticket->reserved_uah)
+            {
+                s_available_uah += ticket->reserved_uah - used;
+            }
+        }
+
+        // SOC moves in coarse steps; without CRATE only learn from drops large enough to be meaningful
+        bool measured = s_has_crate ? s_drain_nah != ticket->start_drain_nah : soc_drop >= MAX17048_BUDGET_MIN_SETTLE_SOC;
+        if (measured && ticket->estimate_uah > 0)
+        {
+            uint32_t ratio = (uint32_t)((uint64_t)used * MAX17048_BUDGET_FACTOR_ONE / ticket->estimate_uah);
+            uint32_t *factor = &s_cost_factor[ticket->cost_class];
+            *factor = *factor - (*factor >> 2) + (ratio >> 2);
+            if (*factor < MAX17048_BUDGET_FACTOR_MIN)
+            {
+                *factor = MAX17048_BUDGET_FACTOR_MIN;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+uint32_t max17048_budget_available_uah(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint32_t available = s_available_uah;
+    portEXIT_CRITICAL(&s_lock);
+    return available;
+}
+
+uint32_t max17048_budget_get_cost_factor(uint8_t cost_class)
+{
+    if (cost_class >= MAX17048_BUDGET_MAX_CLASSES)
+    {
+        return MAX17048_BUDGET_FACTOR_ONE;
+    }
+    return s_cost_factor[cost_class];
+}
@@ -0,0 +1,251 @@
+#include <math.h>
+#include <sys/time.h>
+#include "max17048_deepsleep.h"
+#include "max17048_priv.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "sdkconfig.h"
+#include "soc/soc_caps.h"
+
+static const char *TAG = "MAX17048_DSLEEP";
+
+// 1 uA for an hour in raw SOC (1/256 %) Q8, per mAh of capacity: 256 * 25600 / 1000 = 32768 / 5
+#define DEEPSLEEP_UA_Q8_NUM 32768
+#define DEEPSLEEP_UA_Q8_DEN 5
+
+// SOC drop (1/256 % LSB) before a drain is learned; a smaller one is mostly quantisation
+#define DEEPSLEEP_MIN_LEARN_DROP 16
+
+/**
+ * @brief Learning state kept across deep sleep
+ */
+typedef struct {
+    bool pending;                             // Armed; the next wake folds the sleep into the drain
+    bool learned;                             // drain_q8 holds a measured value
+    uint16_t soc_start;                       // Raw SOC when the sleep was armed
+    int64_t start_us;                         // Wall-clock time when the sleep was armed
+    uint32_t drain_q8;                        // Sleep drain in raw SOC per hour, Q8
+    uint32_t acc_drop;                        // Raw SOC lost over the sleeps not yet learned from
+    int64_t acc_us;                           // Time slept over those sleeps
+} max17048_deepsleep_state_t;
+
+// Global variables
+static RTC_DATA_ATTR max17048_deepsleep_state_t s_state;
+
+// --- Internal Helper Functions ---
+
+static int64_t max17048_deepsleep_now_us(void)
+{
+    // The RTC timer behind gettimeofday keeps running through deep sleep
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void max17048_deepsleep_learn(const max17048_deepsleep_config_t *config, uint16_t soc)
+{
+    if (!s_state.pending || esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UNDEFINED)
+    {
+        return;
+    }
+    s_state.pending = false;
+
+    int64_t elapsed_us = max17048_deepsleep_now_us() - s_state.start_us;
+    if (soc > s_state.soc_start || elapsed_us < 0 || elapsed_us > (int64_t)config->max_sleep_s * 2000000)
+    {
+        // Charged while asleep or the clock was set meanwhile: start accumulating afresh
+        s_state.acc_drop = 0;
+        s_state.acc_us = 0;
+        return;
+    }
+
+    // A sleep that lost no SOC is not a drain of zero: add up sleeps until the drop resolves
+    s_state.acc_drop += s_state.soc_start - soc;
+    s_state.acc_us += elapsed_us;
+    if (s_state.acc_drop < DEEPSLEEP_MIN_LEARN_DROP || s_state.acc_us < (int64_t)config->min_learn_s * 1000000)
+    {
+        return;
+    }
+
+    uint64_t sample_q8 = (uint64_t)s_state.acc_drop * 256 * 3600000000ULL / (uint64_t)s_state.acc_us;
+    s_state.acc_drop = 0;
+    s_state.acc_us = 0;
+    if (sample_q8 > UINT32_MAX)
+    {
+        sample_q8 = UINT32_MAX;
+    }
+    if (!s_state.learned)
+    {
+        s_state.drain_q8 = (uint32_t)sample_q8;
+        s_state.learned = true;
+    }
+    else
+    {
+        s_state.drain_q8 = s_state.drain_q8 - (s_state.drain_q8 >> 2) + (uint32_t)(sample_q8 >> 2);
+    }
+    ESP_LOGD(TAG, "Sleep drain sample %llu, EMA %lu (raw SOC/hr, Q8)", (unsigned long long)sample_q8,
+             (unsigned long)s_state.drain_q8);
+}
+
+static esp_err_t max17048_deepsleep_arm_alert(const max17048_deepsleep_config_t *config)
+{
+    uint16_t reg;
+    esp_err_t ret = max17048_read_register(MAX17048_CONFIG_REG, &reg);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    // Empty alert at (32 - ATHD)%, rounded up so it fires before low_soc is crossed; clearing ALRT releases the pin
+    uint16_t athd = (uint16_t)(32 - (uint32_t)ceilf(config->low_soc));
+    reg = (uint16_t)((reg & ~(MAX17048_CONFIG_ATHD_MASK | MAX17048_CONFIG_ALRT)) | athd);
+    ret = max17048_write_register(MAX17048_CONFIG_REG, reg);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    // ALRT is active low
+    uint64_t mask = 1ULL << config->alert_gpio;
+#if SOC_PM_SUPPORT_EXT1_WAKEUP
+    if (!esp_sleep_is_valid_wakeup_gpio(config->alert_gpio))
+    {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#if CONFIG_IDF_TARGET_ESP32
+    return esp_sleep_enable_ext1_wakeup(mask, ESP_EXT1_WAKEUP_ALL_LOW);
+#else
+    return esp_sleep_enable_ext1_wakeup(mask, ESP_EXT1_WAKEUP_ANY_LOW);
+#endif
+#elif SOC_GPIO_SUPPORT_DEEPSLEEP_WAKEUP
+    return esp_deep_sleep_enable_gpio_wakeup(mask, ESP_GPIO_WAKEUP_GPIO_LOW) == ESP_OK ? ESP_OK
+                                                                                       : ESP_ERR_NOT_SUPPORTED;
+#else
+    (void)mask;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// --- Public API Functions ---
+
+void max17048_deepsleep_get_default_config(max17048_deepsleep_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->capacity_mah = 0;       // Must be set by caller
+    config->low_soc = 10.0f;
+    config->report_delta_soc = 0.0f;
+    config->sleep_ua = 100;
+    config->margin_pct = 80;
+    config->min_sleep_s = 60;
+    config->max_sleep_s = 86400;
+    config->min_learn_s = 1800;
+    config->alert_gpio = GPIO_NUM_NC;
+}
+
+esp_err_t max17048_deepsleep_plan(const max17048_deepsleep_config_t *config, max17048_deepsleep_plan_t *plan)
+{
+    if (config == NULL || plan == NULL || config->capacity_mah == 0 || config->margin_pct == 0 ||
+        config->margin_pct > 100 || config->min_sleep_s > config->max_sleep_s)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    max17048_snapshot_t snapshot;
+    esp_err_t ret = max17048_read_snapshot(&snapshot);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    max17048_deepsleep_learn(config, snapshot.soc);
+
+    // Drain in raw SOC per hour (Q8): learned, else configured, else the awake CRATE
+    uint32_t drain_q8 = 0;
+    if (s_state.learned)
+    {
+        drain_q8 = s_state.drain_q8;
+    }
+    else if (config->sleep_ua > 0)
+    {
+        drain_q8 = (uint32_t)((uint64_t)config->sleep_ua * DEEPSLEEP_UA_Q8_NUM /
+                              ((uint64_t)config->capacity_mah * DEEPSLEEP_UA_Q8_DEN));
+    }
+    else if (snapshot.crate < 0)
+    {
+        // 0.208 %/hr = 53.248 raw SOC/hr
+        drain_q8 = (uint32_t)((uint64_t)-snapshot.crate * 13631488 / 1000);
+    }
+
+    plan->soc = snapshot.soc;
+    plan->crate = snapshot.crate;
+    plan->drain_ua = (uint32_t)((uint64_t)drain_q8 * config->capacity_mah * DEEPSLEEP_UA_Q8_DEN / DEEPSLEEP_UA_Q8_NUM);
+    plan->drain_learned = s_state.learned;
+
+    uint32_t low = (uint32_t)(config->low_soc * 256.0f);
+    plan->below_low = snapshot.soc <= low;
+
+    uint64_t sleep_s = config->max_sleep_s;
+    if (plan->below_low)
+    {
+        sleep_s = config->min_sleep_s;
+    }
+    else if (drain_q8 > 0)
+    {
+        uint64_t budget = snapshot.soc - low;
+        uint32_t delta = (uint32_t)(config->report_delta_soc * 256.0f);
+        if (delta > 0 && delta < budget)
+        {
+            budget = delta;
+        }
+        sleep_s = budget * 256 * 3600 / drain_q8 * config->margin_pct / 100;
+        sleep_s = sleep_s < config->min_sleep_s ? config->min_sleep_s : sleep_s;
+        sleep_s = sleep_s > config->max_sleep_s ? config->max_sleep_s : sleep_s;
+    }
+    plan->sleep_us = sleep_s * 1000000;
+    return ESP_OK;
+}
+
+esp_err_t max17048_deepsleep_arm(const max17048_deepsleep_config_t *config, const max17048_deepsleep_plan_t *plan)
+{
+    if (config == NULL || plan == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (config->alert_gpio != GPIO_NUM_NC)
+    {
+        if (config->low_soc < 1.0f || config->low_soc > 32.0f)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        esp_err_t ret = max17048_deepsleep_arm_alert(config);
+        if (ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to arm ALRT wakeup on GPIO %d: %s", config->alert_gpio, esp_err_to_name(ret));
+            return ret;
+        }
+    }
+
+    esp_err_t ret = esp_sleep_enable_timer_wakeup(plan->sleep_us);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    s_state.soc_start = plan->soc;
+    s_state.start_us = max17048_deepsleep_now_us();
+    s_state.pending = true;
+    return ESP_OK;
+}
+
+void max17048_deepsleep_reset_drain(void)
+{
+    s_state.learned = false;
+    s_state.drain_q8 = 0;
+    s_state.acc_drop = 0;
+    s_state.acc_us = 0;
+    s_state.pending = false;
+}
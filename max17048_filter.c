@@ -0,0 +1,188 @@
+#include <string.h>
+#include "max17048_filter.h"
+
+// --- Internal Helper Functions ---
+
+static int32_t max17048_filter_median(max17048_filter_stage_t *stage, int32_t in)
+{
+    uint8_t n = (uint8_t)stage->config.param;
+    int32_t *sorted = stage->state.window.sorted;
+    uint8_t count = stage->state.window.count;
+
+    // Drop the oldest sample from the sorted copy once the window is full
+    if (count == n)
+    {
+        int32_t oldest = stage->state.window.ring[stage->state.window.head];
+        uint8_t i = 0;
+        while (sorted[i] != oldest)
+        {
+            i++;
+        }
+        memmove(&sorted[i], &sorted[i + 1], (size_t)(count - i - 1) * sizeof(int32_t));
+        count--;
+    }
+
+    uint8_t i = count;
+    while (i > 0 && sorted[i - 1] > in)
+    {
+        sorted[i] = sorted[i - 1];
+        i--;
+    }
+    sorted[i] = in;
+    count++;
+
+    stage->state.window.ring[stage->state.window.head] = in;
+    stage->state.window.head = (uint8_t)((stage->state.window.head + 1) % n);
+    stage->state.window.count = count;
+    return sorted[count / 2];
+}
+
+static int32_t max17048_filter_boxcar(max17048_filter_stage_t *stage, int32_t in)
+{
+    uint8_t n = (uint8_t)stage->config.param;
+    uint8_t head = stage->state.window.head;
+
+    if (stage->state.window.count == n)
+    {
+        stage->state.window.sum -= stage->state.window.ring[head];
+    }
+    else
+    {
+        stage->state.window.count++;
+    }
+    stage->state.window.ring[head] = in;
+    stage->state.window.sum += in;
+    stage->state.window.head = (uint8_t)((head + 1) % n);
+    return stage->state.window.sum / stage->state.window.count;
+}
+
+static bool max17048_filter_stage(max17048_filter_stage_t *stage, int32_t in, int32_t *out)
+{
+    uint16_t param = stage->config.param;
+
+    switch (stage->config.type)
+    {
+    case MAX17048_FILTER_MEDIAN:
+        *out = max17048_filter_median(stage, in);
+        return true;
+
+    case MAX17048_FILTER_EMA:
+        if (!stage->primed)
+        {
+            stage->state.ema.acc = in * (1 << param);
+            stage->primed = true;
+        }
+        else
+        {
+            stage->state.ema.acc += in - (stage->state.ema.acc >> param);
+        }
+        *out = stage->state.ema.acc >> param;
+        return true;
+
+    case MAX17048_FILTER_BOXCAR:
+        *out = max17048_filter_boxcar(stage, in);
+        return true;
+
+    case MAX17048_FILTER_DECIMATE:
+        if (stage->state.decimate.count++ % param != 0)
+        {
+            return false;
+        }
+        stage->state.decimate.count %= param;
+        *out = in;
+        return true;
+
+    case MAX17048_FILTER_RATE_LIMIT:
+        if (stage->primed)
+        {
+            int32_t step = in - stage->state.rate.last;
+            if (step > (int32_t)param)
+            {
+                in = stage->state.rate.last + param;
+            }
+            else if (step < -(int32_t)param)
+            {
+                in = stage->state.rate.last - param;
+            }
+        }
+        stage->state.rate.last = in;
+        stage->primed = true;
+        *out = in;
+        return true;
+    }
+    return false;
+}
+
+// --- Public API Functions ---
+
+esp_err_t max17048_filter_init(max17048_filter_t *filter, const max17048_filter_stage_config_t *stages, size_t num_stages)
+{
+    if (filter == NULL || stages == NULL || num_stages == 0 || num_stages > MAX17048_FILTER_MAX_STAGES)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < num_stages; i++)
+    {
+        uint16_t param = stages[i].param;
+        bool valid;
+        switch (stages[i].type)
+        {
+        case MAX17048_FILTER_MEDIAN:
+            valid = param > 0 && param <= MAX17048_FILTER_MAX_WINDOW && (param & 1);
+            break;
+        case MAX17048_FILTER_EMA:
+            valid = param >= 1 && param <= 15;
+            break;
+        case MAX17048_FILTER_BOXCAR:
+            valid = param > 0 && param <= MAX17048_FILTER_MAX_WINDOW;
+            break;
+        case MAX17048_FILTER_DECIMATE:
+        case MAX17048_FILTER_RATE_LIMIT:
+            valid = param > 0;
+            break;
+        default:
+            valid = false;
+            break;
+        }
+        if (!valid)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    memset(filter, 0, sizeof(*filter));
+    for (size_t i = 0; i < num_stages; i++)
+    {
+        filter->stages[i].config = stages[i];
+    }
+    filter->num_stages = (uint8_t)num_stages;
+    return ESP_OK;
+}
+
+void max17048_filter_reset(max17048_filter_t *filter)
+{
+    if (filter == NULL)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < filter->num_stages; i++)
+    {
+        memset(&filter->stages[i].state, 0, sizeof(filter->stages[i].state));
+        filter->stages[i].primed = false;
+    }
+}
+
+bool max17048_filter_process(max17048_filter_t *filter, int32_t in, int32_t *out)
+{
+    for (uint8_t i = 0; i < filter->num_stages; i++)
+    {
+        if (!max17048_filter_stage(&filter->stages[i], in, &in))
+        {
+            return false;
+        }
+    }
+    *out = in;
+    return true;
+}
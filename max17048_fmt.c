@@ -0,0 +1,113 @@
+#include <stdbool.h>
+#include "max17048_fmt.h"
+
+#define MAX17048_FMT_MAX_DECIMALS 18
+
+static const uint64_t s_pow10[MAX17048_FMT_MAX_DECIMALS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL,
+};
+
+// --- Public API Functions ---
+
+size_t max17048_fmt_fixed(char *buf, size_t size, int64_t value, uint8_t value_decimals, uint8_t decimals)
+{
+    if (buf == NULL || size == 0)
+    {
+        return 0;
+    }
+    buf[0] = '\0';
+    if (value_decimals > MAX17048_FMT_MAX_DECIMALS || decimals > MAX17048_FMT_MAX_DECIMALS)
+    {
+        return 0;
+    }
+
+    uint64_t mag = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    uint8_t shown = decimals < value_decimals ? decimals : value_decimals;
+    if (shown < value_decimals)
+    {
+        // Round half away from zero on the exact decimal value
+        uint64_t div = s_pow10[value_decimals - shown];
+        mag = mag / div + (mag % div >= div / 2 ? 1 : 0);
+    }
+
+    // Digits are produced backwards: padding zeros, fraction, point, integer part
+    char tmp[MAX17048_FMT_MAX_LEN];
+    size_t n = 0;
+    for (uint8_t i = shown; i < decimals; i++)
+    {
+        tmp[n++] = '0';
+    }
+    for (uint8_t i = 0; i < shown; i++)
+    {
+        tmp[n++] = (char)('0' + mag % 10);
+        mag /= 10;
+    }
+    if (decimals > 0)
+    {
+        tmp[n++] = '.';
+    }
+    do
+    {
+        tmp[n++] = (char)('0' + mag % 10);
+        mag /= 10;
+    } while (mag > 0);
+
+    bool negative = value < 0;
+    if (negative)
+    {
+        // No "-0.00" for values that round to zero
+        negative = false;
+        for (size_t i = 0; i < n; i++)
+        {
+            if (tmp[i] > '0')
+            {
+                negative = true;
+                break;
+            }
+        }
+    }
+    if (negative)
+    {
+        tmp[n++] = '-';
+    }
+
+    if (n + 1 > size)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++)
+    {
+        buf[i] = tmp[n - 1 - i];
+    }
+    buf[n] = '\0';
+    return n;
+}
+
+size_t max17048_fmt_vcell(char *buf, size_t size, uint16_t vcell, uint8_t decimals)
+{
+    // 78.125 uV = 78125 nV exactly
+    return max17048_fmt_fixed(buf, size, (int64_t)vcell * 78125, 9, decimals);
+}
+
+size_t max17048_fmt_vcell_stack(char *buf, size_t size, uint16_t vcell, max17048_variant_t variant,
+                                uint8_t decimals)
+{
+#ifdef MAX17048_FIXED_VARIANT
+    variant = MAX17048_FIXED_VARIANT;
+#endif
+    return max17048_fmt_fixed(buf, size, (int64_t)vcell * 78125 * (int64_t)variant, 9, decimals);
+}
+
+size_t max17048_fmt_soc(char *buf, size_t size, uint16_t soc, uint8_t decimals)
+{
+    // 1/256 % = 0.00390625 % exactly
+    return max17048_fmt_fixed(buf, size, (int64_t)soc * 390625, 8, decimals);
+}
+
+size_t max17048_fmt_crate(char *buf, size_t size, int16_t crate, uint8_t decimals)
+{
+    return max17048_fmt_fixed(buf, size, max17048_regs_crate_mpct_hr(crate), 3, decimals);
+}
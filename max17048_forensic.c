@@ -0,0 +1,183 @@
+#include <stdbool.h>
+#include "max17048_forensic.h"
+#include "max17048_sampler.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "MAX17048_FORENSIC";
+
+#define FORENSIC_MAGIC 0x4D464F52             // "MFOR"
+
+// One spare slot: the slot being overwritten may be torn, so it is never reported
+#define FORENSIC_SLOTS (MAX17048_FORENSIC_DEPTH + 1)
+
+/**
+ * @brief Window layout in RTC memory
+ *
+ * The sampler task is the only writer: slot first, then head, then
+ * head_check. A reset between the last two leaves head_check one behind,
+ * which still describes a complete window. A reset during the slot write
+ * leaves that slot torn; it held the oldest sample, which is outside the
+ * reported window.
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t head;                            // Samples written; the next slot is head % FORENSIC_SLOTS
+    uint32_t head_check;                      // ~head once the update has completed
+    max17048_forensic_entry_t ring[FORENSIC_SLOTS];
+} max17048_forensic_rtc_t;
+
+// Global variables
+static RTC_NOINIT_ATTR max17048_forensic_rtc_t s_rtc;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_forensic_report_t s_report;
+static bool s_has_report = false;
+static bool s_boot_checked = false;
+static bool s_running = false;
+
+// --- Internal Helper Functions ---
+
+static bool max17048_forensic_window_valid(void)
+{
+    return s_rtc.magic == FORENSIC_MAGIC &&
+           (s_rtc.head_check == ~s_rtc.head || s_rtc.head_check == ~(s_rtc.head - 1));
+}
+
+static void max17048_forensic_reset_window(void)
+{
+    s_rtc.head = 0;
+    s_rtc.head_check = ~0u;
+    s_rtc.magic = FORENSIC_MAGIC;
+}
+
+static bool max17048_forensic_reason_abnormal(esp_reset_reason_t reason)
+{
+    switch (reason)
+    {
+    case ESP_RST_BROWNOUT:
+    case ESP_RST_PANIC:
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void max17048_forensic_check_boot(void)
+{
+    esp_reset_reason_t reason = esp_reset_reason();
+    bool valid = max17048_forensic_window_valid();
+
+    if (valid && reason == ESP_RST_DEEPSLEEP)
+    {
+        // Keep recording across sleep cycles
+        return;
+    }
+
+    if (valid && s_rtc.head > 0 && max17048_forensic_reason_abnormal(reason))
+    {
+        uint32_t head = s_rtc.head;
+        uint8_t count = head < MAX17048_FORENSIC_DEPTH ? (uint8_t)head : MAX17048_FORENSIC_DEPTH;
+
+        portENTER_CRITICAL(&s_lock);
+        s_report.reset_reason = reason;
+        s_report.total_samples = head;
+        s_report.count = count;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            s_report.entries[i] = s_rtc.ring[(head - count + i) % FORENSIC_SLOTS];
+        }
+        s_has_report = true;
+        portEXIT_CRITICAL(&s_lock);
+
+        const max17048_forensic_entry_t *last = &s_report.entries[count - 1];
+        ESP_LOGW(TAG, "Reset reason %d; last sample VCELL=0x%04X SOC=0x%04X CRATE=%d (%u in window)",
+                 (int)reason, last->vcell, last->soc, last->crate, (unsigned)count);
+    }
+
+    max17048_forensic_reset_window();
+}
+
+static void max17048_forensic_on_snapshot(const max17048_snapshot_t *snapshot, void *user_ctx)
+{
+    uint32_t head = s_rtc.head;
+    max17048_forensic_entry_t *slot = &s_rtc.ring[head % FORENSIC_SLOTS];
+
+    slot->time_ms = (uint32_t)(snapshot->timestamp_us / 1000);
+    slot->vcell = snapshot->vcell;
+    slot->soc = snapshot->soc;
+    slot->crate = snapshot->crate;
+    // s_rtc is plain memory: the barriers keep the compiler from reordering the stores
+    // the torn-slot guarantee depends on (the sampler task is the only writer, on one core)
+    __asm__ __volatile__("" ::: "memory");
+    s_rtc.head = head + 1;
+    __asm__ __volatile__("" ::: "memory");
+    s_rtc.head_check = ~(head + 1);
+}
+
+// --- Public API Functions ---
+
+esp_err_t max17048_forensic_start(void)
+{
+    if (s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!s_boot_checked)
+    {
+        max17048_forensic_check_boot();
+        s_boot_checked = true;
+    }
+
+    // Raw reads, so a decimating filter cannot hide the samples just before the reset
+    esp_err_t err = max17048_sampler_add_raw_listener(max17048_forensic_on_snapshot, NULL);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    s_running = true;
+    return ESP_OK;
+}
+
+esp_err_t max17048_forensic_stop(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = max17048_sampler_remove_raw_listener(max17048_forensic_on_snapshot, NULL);
+    if (err == ESP_OK)
+    {
+        s_running = false;
+    }
+    return err;
+}
+
+esp_err_t max17048_forensic_get_report(max17048_forensic_report_t *report)
+{
+    if (report == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool has_report = s_has_report;
+    if (has_report)
+    {
+        *report = s_report;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return has_report ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void max17048_forensic_clear_report(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_has_report = false;
+    portEXIT_CRITICAL(&s_lock);
+}
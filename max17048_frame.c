@@ -0,0 +1,218 @@
+#include <stdbool.h>
+#include <string.h>
+#include "max17048_frame.h"
+
+// --- Internal Helper Functions ---
+
+static size_t max17048_frame_put_varint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80)
+    {
+        out[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t)value;
+    return n;
+}
+
+static size_t max17048_frame_put_svarint(uint8_t *out, int32_t value)
+{
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    return max17048_frame_put_varint(out, zigzag);
+}
+
+static bool max17048_frame_get_varint(max17048_frame_decoder_t *dec, uint64_t *value)
+{
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64 && dec->pos < dec->len; shift += 7)
+    {
+        uint8_t b = dec->buf[dec->pos++];
+        result |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+        {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool max17048_frame_get_svarint(max17048_frame_decoder_t *dec, int32_t *value)
+{
+    uint64_t zigzag;
+    if (!max17048_frame_get_varint(dec, &zigzag) || zigzag > UINT32_MAX)
+    {
+        return false;
+    }
+    *value = (int32_t)((uint32_t)(zigzag >> 1) ^ (0u - (uint32_t)(zigzag & 1)));
+    return true;
+}
+
+static void max17048_frame_put_le(uint8_t *out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++)
+    {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint64_t max17048_frame_get_le(const uint8_t *in, size_t bytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++)
+    {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+// --- Public API Functions ---
+
+uint32_t max17048_frame_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    // Nibble-wise table keeps the lookup at 64 bytes of flash
+    static const uint32_t table[16] = {
+        0x00000000u, 0x1DB71064u, 0x3B6E20C8u, 0x26D930ACu,
+        0x76DC4190u, 0x6B6B51F4u, 0x4DB26158u, 0x5005713Cu,
+        0xEDB88320u, 0xF00F9344u, 0xD6D6A3E8u, 0xCB61B38Cu,
+        0x9B64C2B0u, 0x86D3D2D4u, 0xA00AE278u, 0xBDBDF21Cu,
+    };
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+esp_err_t max17048_frame_begin(max17048_frame_encoder_t *enc, uint8_t *buf, size_t size, uint64_t device_id)
+{
+    if (enc == NULL || buf == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (size < MAX17048_FRAME_HEADER_SIZE + MAX17048_FRAME_TRAILER_SIZE)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(enc, 0, sizeof(*enc));
+    enc->buf = buf;
+    enc->size = size;
+    buf[0] = MAX17048_FRAME_MAGIC;
+    buf[1] = MAX17048_FRAME_VERSION;
+    max17048_frame_put_le(&buf[2], 0, 2);
+    max17048_frame_put_le(&buf[4], device_id, 8);
+    enc->len = MAX17048_FRAME_HEADER_SIZE;
+    return ESP_OK;
+}
+
+esp_err_t max17048_frame_add(max17048_frame_encoder_t *enc, const max17048_snapshot_t *snapshot)
+{
+    if (enc->count == UINT16_MAX || (enc->count > 0 && snapshot->timestamp_us < enc->prev.timestamp_us))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t record[MAX17048_FRAME_MAX_RECORD_SIZE];
+    size_t n;
+    if (enc->count == 0)
+    {
+        n = max17048_frame_put_varint(record, (uint64_t)snapshot->timestamp_us);
+        n += max17048_frame_put_svarint(&record[n], snapshot->vcell);
+        n += max17048_frame_put_svarint(&record[n], snapshot->soc);
+        n += max17048_frame_put_svarint(&record[n], snapshot->crate);
+    }
+    else
+    {
+        n = max17048_frame_put_varint(record, (uint64_t)(snapshot->timestamp_us - enc->prev.timestamp_us));
+        n += max17048_frame_put_svarint(&record[n], (int32_t)snapshot->vcell - enc->prev.vcell);
+        n += max17048_frame_put_svarint(&record[n], (int32_t)snapshot->soc - enc->prev.soc);
+        n += max17048_frame_put_svarint(&record[n], (int32_t)snapshot->crate - enc->prev.crate);
+    }
+
+    if (enc->len + n + MAX17048_FRAME_TRAILER_SIZE > enc->size)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(&enc->buf[enc->len], record, n);
+    enc->len += n;
+    enc->count++;
+    enc->prev = *snapshot;
+    return ESP_OK;
+}
+
+esp_err_t max17048_frame_finish(max17048_frame_encoder_t *enc, size_t *len)
+{
+    max17048_frame_put_le(&enc->buf[2], enc->count, 2);
+    uint32_t crc = max17048_frame_crc32(0, enc->buf, enc->len);
+    max17048_frame_put_le(&enc->buf[enc->len], crc, 4);
+    *len = enc->len + MAX17048_FRAME_TRAILER_SIZE;
+    return ESP_OK;
+}
+
+esp_err_t max17048_frame_decode_begin(max17048_frame_decoder_t *dec, const uint8_t *buf, size_t len)
+{
+    if (dec == NULL || buf == NULL || len < MAX17048_FRAME_HEADER_SIZE + MAX17048_FRAME_TRAILER_SIZE)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (buf[0] != MAX17048_FRAME_MAGIC || buf[1] != MAX17048_FRAME_VERSION)
+    {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    size_t body = len - MAX17048_FRAME_TRAILER_SIZE;
+    if (max17048_frame_crc32(0, buf, body) != (uint32_t)max17048_frame_get_le(&buf[body], 4))
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    memset(dec, 0, sizeof(*dec));
+    dec->buf = buf;
+    dec->len = body;
+    dec->pos = MAX17048_FRAME_HEADER_SIZE;
+    dec->count = (uint16_t)max17048_frame_get_le(&buf[2], 2);
+    dec->device_id = max17048_frame_get_le(&buf[4], 8);
+    return ESP_OK;
+}
+
+esp_err_t max17048_frame_decode_next(max17048_frame_decoder_t *dec, max17048_snapshot_t *snapshot)
+{
+    if (dec->index == dec->count)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint64_t ts;
+    int32_t vcell, soc, crate;
+    if (!max17048_frame_get_varint(dec, &ts) || !max17048_frame_get_svarint(dec, &vcell) ||
+        !max17048_frame_get_svarint(dec, &soc) || !max17048_frame_get_svarint(dec, &crate))
+    {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (dec->index > 0)
+    {
+        // Wrapping adds: a crafted delta must not overflow, only fail the range check
+        ts += (uint64_t)dec->prev.timestamp_us;
+        vcell = (int32_t)((uint32_t)vcell + dec->prev.vcell);
+        soc = (int32_t)((uint32_t)soc + dec->prev.soc);
+        crate = (int32_t)((uint32_t)crate + (uint32_t)(int32_t)dec->prev.crate);
+    }
+    if (vcell < 0 || vcell > UINT16_MAX || soc < 0 || soc > UINT16_MAX || crate < INT16_MIN || crate > INT16_MAX)
+    {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    snapshot->timestamp_us = (int64_t)ts;
+    snapshot->vcell = (uint16_t)vcell;
+    snapshot->soc = (uint16_t)soc;
+    snapshot->crate = (int16_t)crate;
+    dec->prev = *snapshot;
+    dec->index++;
+    return ESP_OK;
+}
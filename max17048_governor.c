@@ -0,0 +1,176 @@
+#include <string.h>
+#include "max17048_governor.h"
+#include "max17048_sampler.h"
+#include "max17048_filter.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "sdkconfig.h"
+
+static const char *TAG = "MAX17048_GOV";
+
+// Global variables
+static max17048_governor_config_t s_config;
+static max17048_governor_level_t s_levels[MAX17048_GOVERNOR_MAX_LEVELS];
+static max17048_filter_t s_crate_trend;
+static volatile int s_level = -1;
+static uint32_t s_failed_levels;              // Levels esp_pm_configure rejected; skipped until restart
+static bool s_running = false;
+
+// --- Internal Helper Functions ---
+
+static bool max17048_governor_allows(const max17048_governor_level_t *level, float soc, float tte_h, bool step_up)
+{
+    float soc_margin = step_up ? s_config.hysteresis_soc : 0.0f;
+    float tte_margin = step_up ? s_config.hysteresis_tte_h : 0.0f;
+
+    if (soc < level->min_soc + soc_margin)
+    {
+        return false;
+    }
+    return level->min_tte_h <= 0.0f || tte_h >= level->min_tte_h + tte_margin;
+}
+
+static void max17048_governor_on_snapshot(const max17048_snapshot_t *snapshot, void *user_ctx)
+{
+    int32_t trend;
+    max17048_filter_process(&s_crate_trend, snapshot->crate, &trend);
+
+    float soc = snapshot->soc / 256.0f;
+    uint32_t tte_s = max17048_tte_seconds(snapshot->soc, (int16_t)trend);
+    float tte_h = tte_s == MAX17048_TTE_INFINITE ? 1e9f : tte_s / 3600.0f;
+
+    // Most performant level the battery allows; levels above the current one need the margin
+    int current = s_level;
+    int level = (int)s_config.num_levels - 1;
+    for (int i = 0; i < (int)s_config.num_levels; i++)
+    {
+        if (max17048_governor_allows(&s_levels[i], soc, tte_h, current >= 0 && i < current))
+        {
+            level = i;
+            break;
+        }
+    }
+    // A rejected level falls through to the next less performant one, never staying above what the battery allows
+    const max17048_governor_level_t *l = NULL;
+    for (; level < (int)s_config.num_levels; level++)
+    {
+        if (level == current)
+        {
+            return;
+        }
+        if (s_failed_levels & (1u << level))
+        {
+            continue;
+        }
+        l = &s_levels[level];
+        esp_pm_config_t pm_config = {
+            .max_freq_mhz = l->max_freq_mhz,
+            .min_freq_mhz = l->min_freq_mhz,
+            .light_sleep_enable = l->light_sleep_enable,
+        };
+        esp_err_t err = esp_pm_configure(&pm_config);
+        if (err == ESP_OK)
+        {
+            break;
+        }
+        // esp_pm_configure only rejects settings the build or chip cannot run, so a retry would fail too
+        s_failed_levels |= 1u << level;
+        ESP_LOGE(TAG, "Level %d rejected by esp_pm_configure: %s", level, esp_err_to_name(err));
+        l = NULL;
+    }
+    if (l == NULL)
+    {
+        return;
+    }
+    s_level = level;
+    // Integer units (0.1 % and 0.1 h) keep float printf out of the image
+    unsigned soc_dpct = snapshot->soc * 10u / 256u;
+    if (tte_s == MAX17048_TTE_INFINITE)
+    {
+        ESP_LOGI(TAG, "Level %d: SOC %u.%u%%, not discharging -> %d MHz, light sleep %s", level, soc_dpct / 10,
+                 soc_dpct % 10, l->max_freq_mhz, l->light_sleep_enable ? "on" : "off");
+    }
+    else
+    {
+        ESP_LOGI(TAG, "Level %d: SOC %u.%u%%, TTE %lu.%lu h -> %d MHz, light sleep %s", level, soc_dpct / 10,
+                 soc_dpct % 10, (unsigned long)(tte_s / 3600), (unsigned long)(tte_s / 360 % 10), l->max_freq_mhz,
+                 l->light_sleep_enable ? "on" : "off");
+    }
+}
+
+// --- Public API Functions ---
+
+void max17048_governor_get_default_config(max17048_governor_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->levels = NULL;          // Must be set by caller
+    config->num_levels = 0;
+    config->hysteresis_soc = 2.0f;
+    config->hysteresis_tte_h = 0.5f;
+    config->crate_trend_shift = 4;  // alpha = 1/16
+}
+
+esp_err_t max17048_governor_start(const max17048_governor_config_t *config)
+{
+    if (config == NULL || config->levels == NULL || config->num_levels == 0 ||
+        config->num_levels > MAX17048_GOVERNOR_MAX_LEVELS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+#if !CONFIG_PM_ENABLE
+    ESP_LOGE(TAG, "Power management is disabled (CONFIG_PM_ENABLE)");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+
+    max17048_filter_stage_config_t trend = {
+        .type = MAX17048_FILTER_EMA,
+        .param = config->crate_trend_shift,
+    };
+    esp_err_t err = max17048_filter_init(&s_crate_trend, &trend, 1);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    s_config = *config;
+    memcpy(s_levels, config->levels, config->num_levels * sizeof(s_levels[0]));
+    s_config.levels = s_levels;
+    s_level = -1;
+    s_failed_levels = 0;
+
+    err = max17048_sampler_add_listener(max17048_governor_on_snapshot, NULL);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    s_running = true;
+    return ESP_OK;
+}
+
+esp_err_t max17048_governor_stop(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = max17048_sampler_remove_listener(max17048_governor_on_snapshot, NULL);
+    if (err == ESP_OK)
+    {
+        s_running = false;
+    }
+    return err;
+}
+
+int max17048_governor_get_level(void)
+{
+    return s_level;
+}
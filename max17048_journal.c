@@ -0,0 +1,519 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include "max17048_journal.h"
+#include "max17048_frame.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "MAX17048_JOURNAL";
+
+#define MAX17048_JOURNAL_MAGIC 0x324A584D     // "MXJ2"
+#define MAX17048_JOURNAL_SECTOR_HDR 12        // u32 magic, u32 sequence, u32 boot
+#define MAX17048_JOURNAL_WALL_MIN_S 1577836800 // 2020-01-01; earlier wall-clock times mean the clock was never set
+#define MAX17048_JOURNAL_RECORD_HDR 8         // u16 length, u16 type, u32 CRC
+#define MAX17048_JOURNAL_ERASED 0xFFFF
+#define MAX17048_JOURNAL_ALIGN(n) (((n) + 3u) & ~3u)
+
+struct max17048_journal_t {
+    const esp_partition_t *part;
+    SemaphoreHandle_t lock;
+    uint32_t sector_size;
+    uint32_t num_sectors;
+    uint32_t head_sector;                     // Sector being written
+    uint32_t head_seq;                        // Its sequence number
+    uint32_t tail_seq;                        // Oldest sequence still on flash
+    uint32_t boot;                            // Boot number of this open
+    uint32_t write_off;                       // Next record offset in the head sector, buffered bytes included
+    uint8_t *buf;                             // Batch of bytes for [buf_off, buf_off + buf_len) of the head sector
+    size_t buf_size;
+    size_t buf_len;
+    uint32_t buf_off;
+    max17048_journal_stats_t stats;
+};
+
+// --- Internal Helper Functions ---
+
+static uint32_t max17048_journal_record_crc(const uint8_t *hdr, const void *payload, size_t len)
+{
+    uint32_t crc = esp_rom_crc32_le(0, hdr, 4);
+    return esp_rom_crc32_le(crc, payload, len);
+}
+
+static uint32_t max17048_journal_sector_of(max17048_journal_handle_t j, uint32_t seq)
+{
+    return (j->head_sector + j->num_sectors - (j->head_seq - seq) % j->num_sectors) % j->num_sectors;
+}
+
+static esp_err_t max17048_journal_flush_locked(max17048_journal_handle_t j)
+{
+    if (j->buf_len == 0)
+    {
+        return ESP_OK;
+    }
+
+    size_t addr = (size_t)j->head_sector * j->sector_size + j->buf_off;
+    esp_err_t err = esp_partition_write(j->part, addr, j->buf, j->buf_len);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    j->stats.bytes_written += j->buf_len;
+    j->stats.flash_writes++;
+    j->buf_off += j->buf_len;
+    j->buf_len = 0;
+    return ESP_OK;
+}
+
+// Starts the next sector of the ring; the buffer must be empty
+static esp_err_t max17048_journal_advance(max17048_journal_handle_t j)
+{
+    uint32_t next = (j->head_sector + 1) % j->num_sectors;
+    uint32_t seq = j->head_seq + 1;
+
+    esp_err_t err = esp_partition_erase_range(j->part, (size_t)next * j->sector_size, j->sector_size);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    j->stats.sectors_erased++;
+    if (seq - j->tail_seq >= j->num_sectors)
+    {
+        j->tail_seq = seq - j->num_sectors + 1;
+    }
+
+    // The sector header rides along with the first batch of records
+    uint32_t hdr[3] = { MAX17048_JOURNAL_MAGIC, seq, j->boot };
+    memcpy(j->buf, hdr, sizeof(hdr));
+    j->head_sector = next;
+    j->head_seq = seq;
+    j->buf_off = 0;
+    j->buf_len = MAX17048_JOURNAL_SECTOR_HDR;
+    j->write_off = MAX17048_JOURNAL_SECTOR_HDR;
+    return ESP_OK;
+}
+
+// Finds the end of the records in the head sector; returns false if the tail record is torn
+static bool max17048_journal_scan_head(max17048_journal_handle_t j, esp_err_t *err)
+{
+    uint32_t off = MAX17048_JOURNAL_SECTOR_HDR;
+    size_t base = (size_t)j->head_sector * j->sector_size;
+    *err = ESP_OK;
+
+    while (off + MAX17048_JOURNAL_RECORD_HDR <= j->sector_size)
+    {
+        uint8_t hdr[MAX17048_JOURNAL_RECORD_HDR];
+        *err = esp_partition_read(j->part, base + off, hdr, sizeof(hdr));
+        if (*err != ESP_OK)
+        {
+            return false;
+        }
+
+        uint16_t len = hdr[0] | (hdr[1] << 8);
+        uint16_t type = hdr[2] | (hdr[3] << 8);
+        if (len == MAX17048_JOURNAL_ERASED && type == MAX17048_JOURNAL_ERASED)
+        {
+            break;
+        }
+        if (len > j->buf_size - MAX17048_JOURNAL_RECORD_HDR ||
+            off + MAX17048_JOURNAL_RECORD_HDR + len > j->sector_size)
+        {
+            return false;
+        }
+
+        *err = esp_partition_read(j->part, base + off + MAX17048_JOURNAL_RECORD_HDR, j->buf, len);
+        uint32_t crc = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+        if (*err != ESP_OK || max17048_journal_record_crc(hdr, j->buf, len) != crc)
+        {
+            return false;
+        }
+        if (type == MAX17048_JOURNAL_RECORD_BOOT && len >= sizeof(uint32_t))
+        {
+            // A later boot continued in this sector
+            memcpy(&j->boot, j->buf, sizeof(uint32_t));
+        }
+        off += MAX17048_JOURNAL_ALIGN(MAX17048_JOURNAL_RECORD_HDR + len);
+    }
+
+    j->write_off = off;
+    j->buf_off = off;
+    return true;
+}
+
+static esp_err_t max17048_journal_recover(max17048_journal_handle_t j)
+{
+    bool found = false;
+    for (uint32_t s = 0; s < j->num_sectors; s++)
+    {
+        uint32_t hdr[3];
+        esp_err_t err = esp_partition_read(j->part, (size_t)s * j->sector_size, hdr, sizeof(hdr));
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        if (hdr[0] != MAX17048_JOURNAL_MAGIC)
+        {
+            continue;
+        }
+        if (!found || (int32_t)(hdr[1] - j->head_seq) > 0)
+        {
+            j->head_sector = s;
+            j->head_seq = hdr[1];
+            j->boot = hdr[2];
+        }
+        if (!found || (int32_t)(hdr[1] - j->tail_seq) < 0)
+        {
+            j->tail_seq = hdr[1];
+        }
+        found = true;
+    }
+
+    if (!found)
+    {
+        ESP_LOGI(TAG, "Formatting journal partition");
+        j->head_sector = j->num_sectors - 1;
+        j->head_seq = 0;
+        j->tail_seq = 1;
+        j->boot = 1;
+        return max17048_journal_advance(j);
+    }
+
+    // j->boot holds the newest boot seen in the head sector
+    esp_err_t err;
+    bool intact = max17048_journal_scan_head(j, &err);
+    j->boot++;
+    if (!intact)
+    {
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        ESP_LOGW(TAG, "Torn record in sector %lu, continuing in the next one", (unsigned long)j->head_sector);
+        return max17048_journal_advance(j);
+    }
+    return ESP_OK;
+}
+
+// Marks where this boot's records start, with the clocks needed to place them in time
+static esp_err_t max17048_journal_append_boot(max17048_journal_handle_t j)
+{
+    max17048_journal_boot_t boot = {
+        .boot = j->boot,
+        .uptime_us = esp_timer_get_time(),
+    };
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec >= MAX17048_JOURNAL_WALL_MIN_S)
+    {
+        boot.wall_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+    }
+    return max17048_journal_append(j, MAX17048_JOURNAL_RECORD_BOOT, &boot, sizeof(boot));
+}
+
+// --- Public API Functions ---
+
+void max17048_journal_get_default_config(max17048_journal_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->partition_label = "max17048";
+    config->write_buffer_size = 512;
+}
+
+esp_err_t max17048_journal_open(const max17048_journal_config_t *config, max17048_journal_handle_t *ret_journal)
+{
+    if (config == NULL || ret_journal == NULL || config->partition_label == NULL ||
+        config->write_buffer_size < MAX17048_JOURNAL_SECTOR_HDR + MAX17048_JOURNAL_RECORD_HDR + sizeof(max17048_journal_boot_t))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           config->partition_label);
+    if (part == NULL)
+    {
+        ESP_LOGE(TAG, "Partition '%s' not found", config->partition_label);
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (part->size / part->erase_size < 2 || config->write_buffer_size > part->erase_size)
+    {
+        ESP_LOGE(TAG, "Partition needs at least two sectors larger than the write buffer");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct max17048_journal_t *j = calloc(1, sizeof(*j));
+    if (j == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    j->part = part;
+    j->sector_size = part->erase_size;
+    j->num_sectors = part->size / part->erase_size;
+    j->buf_size = MAX17048_JOURNAL_ALIGN(config->write_buffer_size);
+    j->buf = malloc(j->buf_size);
+    j->lock = xSemaphoreCreateMutex();
+    if (j->buf == NULL || j->lock == NULL)
+    {
+        max17048_journal_close(j);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = max17048_journal_recover(j);
+    if (err == ESP_OK)
+    {
+        err = max17048_journal_append_boot(j);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Journal recovery failed: %s", esp_err_to_name(err));
+        max17048_journal_close(j);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Journal open: boot %lu, %lu sectors, seq %lu..%lu, tail at 0x%lx", (unsigned long)j->boot,
+             (unsigned long)j->num_sectors, (unsigned long)j->tail_seq, (unsigned long)j->head_seq,
+             (unsigned long)j->write_off);
+    *ret_journal = j;
+    return ESP_OK;
+}
+
+esp_err_t max17048_journal_close(max17048_journal_handle_t journal)
+{
+    if (journal == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (journal->buf != NULL && journal->lock != NULL)
+    {
+        err = max17048_journal_flush_locked(journal);
+    }
+    if (journal->lock != NULL)
+    {
+        vSemaphoreDelete(journal->lock);
+    }
+    free(journal->buf);
+    free(journal);
+    return err;
+}
+
+esp_err_t max17048_journal_append(max17048_journal_handle_t journal, uint16_t type, const void *data, size_t len)
+{
+    if (journal == NULL || (data == NULL && len > 0))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len > journal->buf_size - MAX17048_JOURNAL_RECORD_HDR)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t need = MAX17048_JOURNAL_ALIGN(MAX17048_JOURNAL_RECORD_HDR + len);
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(journal->lock, portMAX_DELAY);
+    if (journal->write_off + need > journal->sector_size)
+    {
+        err = max17048_journal_flush_locked(journal);
+        if (err == ESP_OK)
+        {
+            err = max17048_journal_advance(journal);
+        }
+    }
+    if (err == ESP_OK && journal->buf_len + need > journal->buf_size)
+    {
+        err = max17048_journal_flush_locked(journal);
+    }
+    if (err == ESP_OK)
+    {
+        uint8_t *rec = &journal->buf[journal->buf_len];
+        rec[0] = (uint8_t)len;
+        rec[1] = (uint8_t)(len >> 8);
+        rec[2] = (uint8_t)type;
+        rec[3] = (uint8_t)(type >> 8);
+        uint32_t crc = max17048_journal_record_crc(rec, data, len);
+        rec[4] = (uint8_t)crc;
+        rec[5] = (uint8_t)(crc >> 8);
+        rec[6] = (uint8_t)(crc >> 16);
+        rec[7] = (uint8_t)(crc >> 24);
+        memcpy(&rec[MAX17048_JOURNAL_RECORD_HDR], data, len);
+        memset(&rec[MAX17048_JOURNAL_RECORD_HDR + len], 0xFF, need - MAX17048_JOURNAL_RECORD_HDR - len);
+
+        journal->buf_len += need;
+        journal->write_off += need;
+        journal->stats.bytes_appended += len;
+    }
+    xSemaphoreGive(journal->lock);
+    return err;
+}
+
+esp_err_t max17048_journal_append_snapshots(max17048_journal_handle_t journal, const max17048_snapshot_t *snapshots, size_t count)
+{
+    if (journal == NULL || (snapshots == NULL && count > 0))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t frame_size = journal->buf_size - MAX17048_JOURNAL_RECORD_HDR;
+    uint8_t *frame = malloc(frame_size);
+    if (frame == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Pack as many snapshots per record as fit, then start another record
+    esp_err_t err = ESP_OK;
+    size_t i = 0;
+    while (err == ESP_OK && i < count)
+    {
+        max17048_frame_encoder_t enc;
+        err = max17048_frame_begin(&enc, frame, frame_size, 0);
+        while (err == ESP_OK && i < count && max17048_frame_add(&enc, &snapshots[i]) == ESP_OK)
+        {
+            i++;
+        }
+        if (err == ESP_OK && enc.count == 0)
+        {
+            err = ESP_ERR_INVALID_ARG;
+        }
+        if (err == ESP_OK)
+        {
+            size_t len;
+            max17048_frame_finish(&enc, &len);
+            err = max17048_journal_append(journal, MAX17048_JOURNAL_RECORD_HISTORY, frame, len);
+        }
+    }
+
+    free(frame);
+    return err;
+}
+
+esp_err_t max17048_journal_flush(max17048_journal_handle_t journal)
+{
+    if (journal == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(journal->lock, portMAX_DELAY);
+    esp_err_t err = max17048_journal_flush_locked(journal);
+    xSemaphoreGive(journal->lock);
+    return err;
+}
+
+void max17048_journal_cursor_first(max17048_journal_handle_t journal, max17048_journal_cursor_t *cursor)
+{
+    xSemaphoreTake(journal->lock, portMAX_DELAY);
+    cursor->seq = journal->tail_seq;
+    cursor->offset = MAX17048_JOURNAL_SECTOR_HDR;
+    cursor->boot = 0;
+    xSemaphoreGive(journal->lock);
+}
+
+esp_err_t max17048_journal_read_next(max17048_journal_handle_t journal, max17048_journal_cursor_t *cursor,
+                                     uint16_t *type, void *buf, size_t size, size_t *len)
+{
+    if (journal == NULL || cursor == NULL || type == NULL || buf == NULL || len == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(journal->lock, portMAX_DELAY);
+    esp_err_t err = max17048_journal_flush_locked(journal);
+    while (err == ESP_OK)
+    {
+        // Sectors older than the tail have been recycled
+        if ((int32_t)(cursor->seq - journal->tail_seq) < 0)
+        {
+            cursor->seq = journal->tail_seq;
+            cursor->offset = MAX17048_JOURNAL_SECTOR_HDR;
+        }
+        if ((int32_t)(cursor->seq - journal->head_seq) > 0 ||
+            (cursor->seq == journal->head_seq && cursor->offset >= journal->write_off))
+        {
+            err = ESP_ERR_NOT_FOUND;
+            break;
+        }
+
+        size_t base = (size_t)max17048_journal_sector_of(journal, cursor->seq) * journal->sector_size;
+        if (cursor->offset == MAX17048_JOURNAL_SECTOR_HDR)
+        {
+            // Records before the sector's first boot record belong to the boot that opened it
+            uint32_t sector_hdr[3];
+            err = esp_partition_read(journal->part, base, sector_hdr, sizeof(sector_hdr));
+            if (err != ESP_OK)
+            {
+                break;
+            }
+            cursor->boot = sector_hdr[2];
+        }
+
+        uint8_t hdr[MAX17048_JOURNAL_RECORD_HDR] = { 0 };
+        uint16_t rec_len = 0;
+        uint16_t rec_type = 0;
+        bool end_of_sector = cursor->offset + MAX17048_JOURNAL_RECORD_HDR > journal->sector_size;
+        if (!end_of_sector)
+        {
+            err = esp_partition_read(journal->part, base + cursor->offset, hdr, sizeof(hdr));
+            if (err != ESP_OK)
+            {
+                break;
+            }
+            rec_len = hdr[0] | (hdr[1] << 8);
+            rec_type = hdr[2] | (hdr[3] << 8);
+            end_of_sector = (rec_len == MAX17048_JOURNAL_ERASED && rec_type == MAX17048_JOURNAL_ERASED) ||
+                            cursor->offset + MAX17048_JOURNAL_RECORD_HDR + rec_len > journal->sector_size;
+        }
+        if (end_of_sector)
+        {
+            cursor->seq++;
+            cursor->offset = MAX17048_JOURNAL_SECTOR_HDR;
+            continue;
+        }
+        if (rec_len > size)
+        {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+
+        err = esp_partition_read(journal->part, base + cursor->offset + MAX17048_JOURNAL_RECORD_HDR, buf, rec_len);
+        if (err != ESP_OK)
+        {
+            break;
+        }
+        uint32_t crc = hdr[4] | (hdr[5] << 8) | (hdr[6] << 16) | ((uint32_t)hdr[7] << 24);
+        if (max17048_journal_record_crc(hdr, buf, rec_len) != crc)
+        {
+            // A torn record ends its sector: nothing after it was written
+            cursor->seq++;
+            cursor->offset = MAX17048_JOURNAL_SECTOR_HDR;
+            continue;
+        }
+
+        cursor->offset += MAX17048_JOURNAL_ALIGN(MAX17048_JOURNAL_RECORD_HDR + rec_len);
+        if (rec_type == MAX17048_JOURNAL_RECORD_BOOT && rec_len >= sizeof(uint32_t))
+        {
+            memcpy(&cursor->boot, buf, sizeof(uint32_t));
+        }
+        *type = rec_type;
+        *len = rec_len;
+        break;
+    }
+    xSemaphoreGive(journal->lock);
+    return err;
+}
+
+void max17048_journal_get_stats(max17048_journal_handle_t journal, max17048_journal_stats_t *stats)
+{
+    xSemaphoreTake(journal->lock, portMAX_DELAY);
+    *stats = journal->stats;
+    xSemaphoreGive(journal->lock);
+}
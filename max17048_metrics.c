@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <string.h>
+#include "max17048_metrics.h"
+#include "max17048_fmt.h"
+
+typedef enum {
+    FAMILY_TRANSACTIONS,
+    FAMILY_ERRORS,
+    FAMILY_LATENCY,
+    FAMILY_CACHE_HITS,
+    FAMILY_CACHE_MISSES,
+    FAMILY_SOC,
+    FAMILY_VOLTAGE,
+    FAMILY_CRATE,
+    FAMILY_TTE,
+    FAMILY_EOF,
+    FAMILY_MAX,
+} max17048_metrics_family_t;
+
+typedef struct {
+    const char *name;
+    const char *type;
+    const char *help;
+    bool per_gauge;
+} max17048_metrics_family_info_t;
+
+static const max17048_metrics_family_info_t families[FAMILY_MAX] = {
+    [FAMILY_TRANSACTIONS] = { "max17048_i2c_transactions", "counter", "I2C transactions issued.", false },
+    [FAMILY_ERRORS] = { "max17048_i2c_errors", "counter", "I2C transactions that failed.", false },
+    [FAMILY_LATENCY] = { "max17048_i2c_latency_seconds", "histogram", "I2C transaction latency.", false },
+    [FAMILY_CACHE_HITS] = { "max17048_cache_hits", "counter", "Reads served from the latest snapshot.", false },
+    [FAMILY_CACHE_MISSES] = { "max17048_cache_misses", "counter", "Cached reads without data.", false },
+    [FAMILY_SOC] = { "max17048_battery_soc_percent", "gauge", "State of charge.", true },
+    [FAMILY_VOLTAGE] = { "max17048_battery_voltage_volts", "gauge", "Battery voltage (the two-cell stack on a MAX17049).", true },
+    [FAMILY_CRATE] = { "max17048_battery_charge_rate_percent_per_hour", "gauge", "Charge (+) or discharge (-) rate.", true },
+    [FAMILY_TTE] = { "max17048_battery_time_to_empty_seconds", "gauge", "Projected time to empty.", true },
+};
+
+// --- Internal Helper Functions ---
+
+// Fixed-point value with snprintf-style length: a value that does not fit uses up the buffer
+static int max17048_metrics_fixed(size_t size, size_t len)
+{
+    return len == 0 && size > 0 ? (int)size : (int)len;
+}
+
+static int max17048_metrics_gauge_value(char *out, size_t size, max17048_metrics_family_t family,
+                                        const max17048_snapshot_t *s)
+{
+    switch (family)
+    {
+    case FAMILY_SOC:
+        return max17048_metrics_fixed(size, max17048_fmt_soc(out, size, s->soc, 8));
+    case FAMILY_VOLTAGE:
+        return max17048_metrics_fixed(size, max17048_fmt_vcell_stack(out, size, s->vcell, max17048_get_variant(), 9));
+    case FAMILY_CRATE:
+        return max17048_metrics_fixed(size, max17048_fmt_crate(out, size, s->crate, 3));
+    default:
+    {
+        uint32_t tte = max17048_tte_seconds(s->soc, s->crate);
+        if (tte == MAX17048_TTE_INFINITE)
+        {
+            return snprintf(out, size, "+Inf");
+        }
+        return snprintf(out, size, "%lu", (unsigned long)tte);
+    }
+    }
+}
+
+// Formats line `line` of `family`; returns 0 when the family has no such line
+static int max17048_metrics_line(const max17048_metrics_renderer_t *r, max17048_metrics_family_t family, size_t line,
+                                 char *out, size_t size)
+{
+    const max17048_metrics_family_info_t *info = &families[family];
+
+    if (family == FAMILY_EOF)
+    {
+        return line == 0 ? snprintf(out, size, "# EOF\n") : 0;
+    }
+    if (info->per_gauge ? r->num_gauges == 0 : r->stats == NULL)
+    {
+        return 0;
+    }
+    if (line == 0)
+    {
+        return snprintf(out, size, "# TYPE %s %s\n", info->name, info->type);
+    }
+    if (line == 1)
+    {
+        return snprintf(out, size, "# HELP %s %s\n", info->name, info->help);
+    }
+    line -= 2;
+
+    if (info->per_gauge)
+    {
+        if (line >= r->num_gauges)
+        {
+            return 0;
+        }
+        const max17048_metrics_gauge_t *g = &r->gauges[line];
+        int n = snprintf(out, size, "%s{gauge=\"%s\"} ", info->name, g->label);
+        if ((size_t)n >= size)
+        {
+            return n;
+        }
+        n += max17048_metrics_gauge_value(out + n, size - n, family, g->snapshot);
+        return n + snprintf(out + n, size - n, "\n");
+    }
+
+    const max17048_stats_t *st = r->stats;
+    switch (family)
+    {
+    case FAMILY_TRANSACTIONS:
+        return line == 0 ? snprintf(out, size, "%s_total %lu\n", info->name, (unsigned long)st->transactions) : 0;
+    case FAMILY_ERRORS:
+        return line == 0 ? snprintf(out, size, "%s_total %lu\n", info->name, (unsigned long)st->errors) : 0;
+    case FAMILY_CACHE_HITS:
+        return line == 0 ? snprintf(out, size, "%s_total %lu\n", info->name, (unsigned long)st->cache_hits) : 0;
+    case FAMILY_CACHE_MISSES:
+        return line == 0 ? snprintf(out, size, "%s_total %lu\n", info->name, (unsigned long)st->cache_misses) : 0;
+    default:
+        break;
+    }
+
+    // Histogram: cumulative buckets, then count and sum
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b <= line && b < MAX17048_STATS_LATENCY_BUCKETS; b++)
+    {
+        cumulative += st->latency_buckets[b];
+    }
+    if (line < MAX17048_STATS_LATENCY_BUCKETS - 1)
+    {
+        int n = snprintf(out, size, "%s_bucket{le=\"", info->name);
+        n += max17048_metrics_fixed(size - n,
+                                    max17048_fmt_fixed(out + n, size - n, max17048_stats_latency_bounds_us[line], 6, 6));
+        return n + snprintf(out + n, size - n, "\"} %llu\n", (unsigned long long)cumulative);
+    }
+    if (line == MAX17048_STATS_LATENCY_BUCKETS - 1)
+    {
+        return snprintf(out, size, "%s_bucket{le=\"+Inf\"} %llu\n", info->name, (unsigned long long)cumulative);
+    }
+    if (line == MAX17048_STATS_LATENCY_BUCKETS)
+    {
+        return snprintf(out, size, "%s_count %llu\n", info->name, (unsigned long long)cumulative);
+    }
+    if (line == MAX17048_STATS_LATENCY_BUCKETS + 1)
+    {
+        int n = snprintf(out, size, "%s_sum ", info->name);
+        n += max17048_metrics_fixed(size - n,
+                                    max17048_fmt_fixed(out + n, size - n, (int64_t)st->latency_sum_us, 6, 6));
+        return n + snprintf(out + n, size - n, "\n");
+    }
+    return 0;
+}
+
+// --- Public API Functions ---
+
+void max17048_metrics_begin(max17048_metrics_renderer_t *renderer, const max17048_stats_t *stats,
+                            const max17048_metrics_gauge_t *gauges, size_t num_gauges)
+{
+    renderer->stats = stats;
+    renderer->gauges = gauges;
+    renderer->num_gauges = gauges != NULL ? num_gauges : 0;
+    renderer->family = 0;
+    renderer->line = 0;
+}
+
+esp_err_t max17048_metrics_render(max17048_metrics_renderer_t *renderer, char *buf, size_t size, size_t *len)
+{
+    if (renderer == NULL || buf == NULL || len == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char line[MAX17048_METRICS_MIN_BUFFER];
+    size_t used = 0;
+    *len = 0;
+
+    while (renderer->family < FAMILY_MAX)
+    {
+        int n = max17048_metrics_line(renderer, (max17048_metrics_family_t)renderer->family, renderer->line,
+                                      line, sizeof(line));
+        if (n <= 0)
+        {
+            renderer->family++;
+            renderer->line = 0;
+            continue;
+        }
+        if ((size_t)n >= sizeof(line) || used + (size_t)n > size)
+        {
+            // Resume with this line on the next call
+            if (used == 0)
+            {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            break;
+        }
+        memcpy(buf + used, line, n);
+        used += n;
+        renderer->line++;
+    }
+
+    *len = used;
+    return ESP_OK;
+}
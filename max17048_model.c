@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include "max17048_model.h"
+#include "max17048_priv.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "MAX17048_MODEL";
+
+#define MAX17048_MODEL_UNLOCK_RETRIES 3
+#define MAX17048_MODEL_SETTLE_MS 200          // Datasheet: 150-600 ms after writing OCVTest
+#define MAX17048_MODEL_RELOCK_MS 150          // Datasheet: at least 150 ms after the final lock
+#define MAX17048_MODEL_SOC_PER_POINT 2560     // 10% in raw SOC units
+
+// --- Internal Helper Functions ---
+
+// Model OCV at a raw SOC, in microvolts
+static uint32_t max17048_model_ocv_uv(const max17048_model_t *model, uint16_t soc)
+{
+    uint32_t seg = soc / MAX17048_MODEL_SOC_PER_POINT;
+    if (seg >= MAX17048_MODEL_OCV_POINTS - 1)
+    {
+        return model->ocv_mv[MAX17048_MODEL_OCV_POINTS - 1] * 1000u;
+    }
+    int32_t lo = model->ocv_mv[seg] * 1000;
+    int32_t hi = model->ocv_mv[seg + 1] * 1000;
+    int32_t frac = soc % MAX17048_MODEL_SOC_PER_POINT;
+    return (uint32_t)(lo + (hi - lo) * frac / MAX17048_MODEL_SOC_PER_POINT);
+}
+
+static uint32_t max17048_model_error_uv(const max17048_model_t *model, const max17048_model_obs_t *obs, size_t num_obs)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < num_obs; i++)
+    {
+        // VCELL LSB is 78.125 uV per cell on either variant
+        uint32_t vcell_uv = (uint32_t)obs[i].vcell * 625 / 8;
+        uint32_t ocv_uv = max17048_model_ocv_uv(model, obs[i].soc);
+        sum += vcell_uv > ocv_uv ? vcell_uv - ocv_uv : ocv_uv - vcell_uv;
+    }
+    return (uint32_t)(sum / num_obs);
+}
+
+static esp_err_t max17048_model_unlock(uint16_t *ocv)
+{
+    for (int attempt = 0; attempt < MAX17048_MODEL_UNLOCK_RETRIES; attempt++)
+    {
+        esp_err_t ret = max17048_write_register(MAX17048_MODEL_LOCK_REG, MAX17048_MODEL_UNLOCK_KEY);
+        if (ret == ESP_OK)
+        {
+            ret = max17048_read_register(MAX17048_OCV_REG, ocv);
+        }
+        if (ret != ESP_OK)
+        {
+            return ret;
+        }
+        // OCV reads back as 0xFFFF while the model is still locked
+        if (*ocv != 0xFFFF)
+        {
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
+static esp_err_t max17048_model_lock(void)
+{
+    return max17048_write_register(MAX17048_MODEL_LOCK_REG, 0x0000);
+}
+
+static esp_err_t max17048_model_restore(uint16_t config, uint16_t ocv, uint16_t hibrt)
+{
+    uint16_t unused;
+    esp_err_t ret = max17048_model_unlock(&unused);
+    if (ret == ESP_OK)
+    {
+        ret = max17048_write_register(MAX17048_CONFIG_REG, config);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = max17048_write_register(MAX17048_OCV_REG, ocv);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = max17048_write_register(MAX17048_HIBRT_REG, hibrt);
+    }
+    esp_err_t lock_ret = max17048_model_lock();
+    // Let the gauge settle on the restored OCV before anyone reads SOC
+    vTaskDelay(pdMS_TO_TICKS(MAX17048_MODEL_RELOCK_MS));
+    return ret != ESP_OK ? ret : lock_ret;
+}
+
+static esp_err_t max17048_model_write(const max17048_model_t *model)
+{
+    // 16-byte bursts: 4 for the table and 2 for RCOMPSeg instead of 48 word writes
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < MAX17048_MODEL_TABLE_SIZE && ret == ESP_OK; i += MAX17048_WRITE_BURST_MAX)
+    {
+        ret = max17048_write_burst(MAX17048_MODEL_TABLE_REG + i, &model->table[i], MAX17048_WRITE_BURST_MAX);
+    }
+
+    uint8_t seg[MAX17048_WRITE_BURST_MAX];
+    for (int i = 0; i < MAX17048_WRITE_BURST_MAX; i += 2)
+    {
+        seg[i] = (uint8_t)(model->rcomp_seg >> 8);
+        seg[i + 1] = (uint8_t)model->rcomp_seg;
+    }
+    for (int i = 0; i < MAX17048_RCOMPSEG_WORDS * 2 && ret == ESP_OK; i += MAX17048_WRITE_BURST_MAX)
+    {
+        ret = max17048_write_burst(MAX17048_RCOMPSEG_REG + i, seg, sizeof(seg));
+    }
+    return ret;
+}
+
+// --- Public API Functions ---
+
+esp_err_t max17048_model_collector_init(max17048_model_collector_t *collector, max17048_model_obs_t *storage, size_t capacity,
+                                        float crate_relaxed_pct_hr, uint32_t relax_ms, float min_soc_step_pct)
+{
+    if (collector == NULL || storage == NULL || capacity == 0 || crate_relaxed_pct_hr < 0.0f || min_soc_step_pct < 0.0f)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    collector->obs = storage;
+    collector->capacity = capacity;
+    collector->count = 0;
+    collector->crate_relaxed = (int16_t)(crate_relaxed_pct_hr / MAX17048_CRATE_LSB_PCT_HR);
+    collector->min_soc_step = (uint16_t)(min_soc_step_pct / MAX17048_SOC_LSB_PCT);
+    collector->relax_us = (int64_t)relax_ms * 1000;
+    collector->quiet_since_us = -1;
+    collector->refining = false;
+    collector->last_soc = 0;
+    return ESP_OK;
+}
+
+void max17048_model_collector_cb(const max17048_snapshot_t *snapshot, void *ctx)
+{
+    max17048_model_collector_t *collector = ctx;
+    int32_t crate = snapshot->crate;
+
+    if (crate > collector->crate_relaxed || -crate > collector->crate_relaxed)
+    {
+        collector->quiet_since_us = -1;
+        collector->refining = false;
+        return;
+    }
+    if (collector->quiet_since_us < 0)
+    {
+        collector->quiet_since_us = snapshot->timestamp_us;
+        return;
+    }
+    if (snapshot->timestamp_us - collector->quiet_since_us < collector->relax_us)
+    {
+        return;
+    }
+
+    uint16_t step = abs((int32_t)snapshot->soc - collector->last_soc);
+    max17048_model_obs_t obs = { .vcell = snapshot->vcell, .soc = snapshot->soc };
+    if (collector->refining)
+    {
+        // Still resting: the longer the rest, the closer VCELL is to OCV
+        collector->obs[collector->count - 1] = obs;
+    }
+    else if ((collector->count == 0 || step >= collector->min_soc_step) && collector->count < collector->capacity)
+    {
+        collector->obs[collector->count++] = obs;
+        collector->refining = true;
+    }
+    else
+    {
+        return;
+    }
+    collector->last_soc = snapshot->soc;
+}
+
+esp_err_t max17048_model_identify(const max17048_model_t *models, size_t num_models, const max17048_model_obs_t *obs,
+                                  size_t num_obs, uint32_t min_margin_uv, max17048_model_match_t *match)
+{
+    if (models == NULL || num_models == 0 || obs == NULL || match == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (num_obs < MAX17048_MODEL_MIN_OBS)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    match->index = 0;
+    match->error_uv = UINT32_MAX;
+    match->runner_up_error_uv = UINT32_MAX;
+    for (size_t i = 0; i < num_models; i++)
+    {
+        uint32_t error = max17048_model_error_uv(&models[i], obs, num_obs);
+        if (error < match->error_uv)
+        {
+            match->runner_up_error_uv = match->error_uv;
+            match->error_uv = error;
+            match->index = i;
+        }
+        else if (error < match->runner_up_error_uv)
+        {
+            match->runner_up_error_uv = error;
+        }
+    }
+
+    ESP_LOGI(TAG, "Best model %s: %lu uV mean error, runner-up %lu uV", models[match->index].name,
+             (unsigned long)match->error_uv, (unsigned long)match->runner_up_error_uv);
+    if (match->runner_up_error_uv - match->error_uv < min_margin_uv)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t max17048_model_load(const max17048_model_t *model)
+{
+    if (model == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint16_t ocv, config, hibrt, soc;
+    esp_err_t ret = max17048_model_unlock(&ocv);
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Model unlock failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = max17048_read_register(MAX17048_CONFIG_REG, &config);
+    if (ret == ESP_OK)
+    {
+        ret = max17048_read_register(MAX17048_HIBRT_REG, &hibrt);
+    }
+    if (ret != ESP_OK)
+    {
+        // Nothing written yet
+        max17048_model_lock();
+        vTaskDelay(pdMS_TO_TICKS(MAX17048_MODEL_RELOCK_MS));
+        return ret;
+    }
+
+    ret = max17048_model_write(model);
+    if (ret == ESP_OK)
+    {
+        ret = max17048_write_register(MAX17048_OCV_REG, model->ocv_test);
+    }
+    if (ret == ESP_OK)
+    {
+        // Hibernate would stop the SOC update the check depends on
+        ret = max17048_write_register(MAX17048_HIBRT_REG, 0x0000);
+    }
+    if (ret == ESP_OK)
+    {
+        ret = max17048_model_lock();
+    }
+    if (ret == ESP_OK)
+    {
+        vTaskDelay(pdMS_TO_TICKS(MAX17048_MODEL_SETTLE_MS));
+        ret = max17048_read_register(MAX17048_SOC_REG, &soc);
+    }
+    bool valid = false;
+    uint8_t soc_check = 0;
+    if (ret == ESP_OK)
+    {
+        soc_check = model->bits19 ? (uint8_t)(soc >> 9) : (uint8_t)(soc >> 8);
+        valid = soc_check >= model->soc_check_a && soc_check <= model->soc_check_b;
+    }
+
+    // Whatever failed above, never leave OCV forced or hibernate off: restore the measured
+    // OCV and hibernate settings, and apply the model's RCOMP0 only if it checked out
+    uint16_t new_config = valid ? (uint16_t)((model->rcomp0 << 8) | (config & 0xFF)) : config;
+    esp_err_t restore_ret = max17048_model_restore(new_config, ocv, hibrt);
+    if (ret == ESP_OK)
+    {
+        ret = restore_ret;
+    }
+    if (ret != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Loading model %s failed: %s", model->name, esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (!valid)
+    {
+        ESP_LOGE(TAG, "Model %s failed SOC check (0x%02x not in 0x%02x-0x%02x)", model->name, soc_check,
+                 model->soc_check_a, model->soc_check_b);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    ESP_LOGI(TAG, "Loaded model %s, RCOMP0 0x%02x", model->name, model->rcomp0);
+    return ESP_OK;
+}
+
+esp_err_t max17048_model_auto_load(const max17048_model_t *models, size_t num_models, const max17048_model_obs_t *obs,
+                                   size_t num_obs, uint32_t min_margin_uv, max17048_model_match_t *match)
+{
+    esp_err_t ret = max17048_model_identify(models, num_models, obs, num_obs, min_margin_uv, match);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    return max17048_model_load(&models[match->index]);
+}
+
+uint8_t max17048_model_rcomp(const max17048_model_t *model, int32_t temp_dc)
+{
+    // RCOMP = RCOMP0 + (T - 20) * TempCo, TempCo in Q8 per degree and T in 0.1 degrees
+    int32_t delta = temp_dc - 200;
+    int32_t temp_co = delta > 0 ? model->temp_co_up_q8 : model->temp_co_down_q8;
+    int32_t rcomp = model->rcomp0 + delta * temp_co / 2560;
+    if (rcomp < 0)
+    {
+        return 0;
+    }
+    return rcomp > 255 ? 255 : (uint8_t)rcomp;
+}
@@ -0,0 +1,139 @@
+#include "max17048_ota.h"
+#include "max17048_budget.h"
+#include "max17048_sampler.h"
+#include "freertos/FreeRTOS.h"
+
+// Global variables
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_ota_config_t s_config;
+static bool s_running = false;
+static bool s_has_state = false;
+static uint16_t s_soc;                        // Latest raw SOC
+static uint32_t s_vcell_mv;                   // Latest VCELL
+static uint32_t s_rest_mv;                    // VCELL at idle load (EMA)
+static uint32_t s_resistance_mohm;            // Peak-held internal resistance estimate
+
+// --- Internal Helper Functions ---
+
+static void max17048_ota_on_snapshot(const max17048_snapshot_t *snapshot, void *user_ctx)
+{
+    // VCELL: 78.125uV = 5/64 mV per cell on either variant; CRATE: 0.208%/hr of capacity, discharge positive
+    uint32_t vcell_mv = (uint32_t)snapshot->vcell * 5 / 64;
+    int32_t load_ma = (int32_t)((int64_t)-snapshot->crate * 208 * (int64_t)s_config.capacity_mah / 100000);
+
+    portENTER_CRITICAL(&s_lock);
+    s_soc = snapshot->soc;
+    s_vcell_mv = vcell_mv;
+    if (!s_has_state)
+    {
+        s_rest_mv = vcell_mv;
+        s_has_state = true;
+    }
+    else if (load_ma >= 0 && load_ma < s_config.idle_ma)
+    {
+        // Charging samples are left out: they would lift the rest voltage towards the charge voltage
+        s_rest_mv = s_rest_mv - (s_rest_mv >> 3) + (vcell_mv >> 3);
+    }
+    else if (load_ma >= s_config.idle_ma && s_rest_mv > vcell_mv)
+    {
+        // Sag under load: keep the worst resistance seen, decaying slowly so old peaks age out
+        uint32_t resistance = (s_rest_mv - vcell_mv) * 1000 / (uint32_t)load_ma;
+        s_resistance_mohm -= s_resistance_mohm >> 8;
+        if (resistance > s_resistance_mohm)
+        {
+            s_resistance_mohm = resistance;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// --- Public API Functions ---
+
+void max17048_ota_get_default_config(max17048_ota_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->capacity_mah = 0;       // Must be set by caller
+    config->reserve_soc = 10.0f;
+    config->cutoff_mv = 3300;
+    config->idle_ma = 20;
+}
+
+esp_err_t max17048_ota_start(const max17048_ota_config_t *config)
+{
+    if (config == NULL || config->capacity_mah == 0 || config->idle_ma == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_config = *config;
+    s_has_state = false;
+    s_resistance_mohm = 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    esp_err_t err = max17048_sampler_add_listener(max17048_ota_on_snapshot, NULL);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    s_running = true;
+    return ESP_OK;
+}
+
+esp_err_t max17048_ota_stop(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_running = false;
+    return max17048_sampler_remove_listener(max17048_ota_on_snapshot, NULL);
+}
+
+esp_err_t max17048_ota_check(const max17048_ota_workload_t *workload, max17048_ota_decision_t *decision)
+{
+    if (workload == NULL || decision == NULL || workload->throughput_bps == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool ready = s_running && s_has_state;
+    uint16_t soc = s_soc;
+    uint32_t rest_mv = s_rest_mv < s_vcell_mv ? s_vcell_mv : s_rest_mv;
+    uint32_t resistance_mohm = s_resistance_mohm;
+    portEXIT_CRITICAL(&s_lock);
+    if (!ready)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Radio charge over the download time plus flash erase/write charge
+    uint64_t radio_uah = (uint64_t)workload->radio_ma * workload->image_size * 1000 / workload->throughput_bps / 3600;
+    uint64_t flash_uah = (uint64_t)workload->flash_uah_per_kb * ((workload->image_size + 1023) / 1024);
+    uint64_t required = radio_uah + flash_uah;
+    if (workload->cost_class != MAX17048_OTA_NO_COST_CLASS)
+    {
+        required = required * max17048_budget_get_cost_factor(workload->cost_class) / 256;
+    }
+
+    // Charge to raw SOC units: uAh / (capacity_mah * 1000) * 25600
+    int64_t required_soc = (int64_t)(required * 25600 / ((uint64_t)s_config.capacity_mah * 1000));
+    int64_t margin_soc = (int64_t)soc - (int64_t)(s_config.reserve_soc * 256.0f) - required_soc;
+    int32_t loaded_mv = (int32_t)rest_mv - (int32_t)(resistance_mohm * workload->radio_ma / 1000);
+
+    decision->required_uah = required > UINT32_MAX ? UINT32_MAX : (uint32_t)required;
+    decision->margin_soc = margin_soc / 256.0f;
+    decision->margin_mv = loaded_mv - (int32_t)s_config.cutoff_mv;
+    decision->go = margin_soc >= 0 && decision->margin_mv >= 0;
+    return ESP_OK;
+}
@@ -0,0 +1,453 @@
+#include <stdlib.h>
+#include "max17048_pack.h"
+#include "max17048_priv.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "MAX17048_PACK";
+
+typedef struct {
+    struct max17048_pack_t *pack;
+    size_t index;
+    i2c_master_bus_handle_t bus;
+    i2c_master_dev_handle_t dev;
+    uint8_t selected_channel;                 // Channel the mux currently routes to
+    size_t first;                             // Range of this bus's cells in the sweep order
+    size_t last;
+    TaskHandle_t worker;                      // Per-bus worker when parallel_buses is set
+    esp_err_t result;                         // Outcome of this bus's part of the sweep
+    uint16_t transactions;
+    uint16_t mux_switches;
+} max17048_pack_bus_t;
+
+struct max17048_pack_t {
+    max17048_pack_config_t config;
+    max17048_pack_cell_t *cells;
+    uint8_t *cell_bus;                        // Bus index per cell
+    size_t *order;                            // Sweep order (cell indices)
+    max17048_pack_bus_t *buses;
+    size_t num_buses;
+    SemaphoreHandle_t lock;                   // Serialises sweeps: workers, pending and bus results are shared
+    EventGroupHandle_t done;                  // One bit per bus, set when its worker finishes
+    max17048_snapshot_t *pending;             // Sample array of the sweep in progress
+    volatile bool stopping;
+};
+
+#define MAX17048_PACK_MAX_WORKERS 24          // Usable bits of an event group
+
+// --- Internal Helper Functions ---
+
+static bool max17048_pack_before(const struct max17048_pack_t *pack, size_t a, size_t b)
+{
+    if (pack->cell_bus[a] != pack->cell_bus[b])
+    {
+        return pack->cell_bus[a] < pack->cell_bus[b];
+    }
+    return pack->cells[a].mux_channel < pack->cells[b].mux_channel;
+}
+
+static void max17048_pack_plan(struct max17048_pack_t *pack)
+{
+    size_t n = pack->config.num_cells;
+    for (size_t i = 0; i < n; i++)
+    {
+        pack->order[i] = i;
+    }
+    // Insertion sort: packs are small and this runs once
+    for (size_t i = 1; i < n; i++)
+    {
+        size_t cell = pack->order[i];
+        size_t j = i;
+        while (j > 0 && max17048_pack_before(pack, cell, pack->order[j - 1]))
+        {
+            pack->order[j] = pack->order[j - 1];
+            j--;
+        }
+        pack->order[j] = cell;
+    }
+
+    // Sorting groups the cells by bus; record each bus's slice of the order
+    for (size_t k = 0; k < n; k++)
+    {
+        max17048_pack_bus_t *bus = &pack->buses[pack->cell_bus[pack->order[k]]];
+        if (k == 0 || pack->cell_bus[pack->order[k - 1]] != pack->cell_bus[pack->order[k]])
+        {
+            bus->first = k;
+        }
+        bus->last = k + 1;
+    }
+}
+
+static void max17048_pack_sweep_bus(max17048_pack_handle_t pack, max17048_pack_bus_t *bus, max17048_snapshot_t *samples)
+{
+    const max17048_pack_config_t *cfg = &pack->config;
+    bus->transactions = 0;
+    bus->mux_switches = 0;
+    bus->result = ESP_OK;
+
+    for (size_t k = bus->first; k < bus->last; k++)
+    {
+        size_t cell = pack->order[k];
+        uint8_t channel = pack->cells[cell].mux_channel;
+
+        if (channel != MAX17048_PACK_NO_MUX && channel != bus->selected_channel)
+        {
+            bus->result = cfg->mux_select(bus->bus, channel, cfg->mux_user_ctx);
+            if (bus->result != ESP_OK)
+            {
+                bus->selected_channel = MAX17048_PACK_NO_MUX;
+                return;
+            }
+            bus->selected_channel = channel;
+            bus->mux_switches++;
+        }
+
+        // CRATE is read here rather than by read_snapshot so that a failed first read is counted alone
+        bus->result = max17048_i2c_read_snapshot(bus->dev, cfg->i2c_timeout_ms, false, &samples[cell]);
+        bus->transactions++;
+        if (bus->result == ESP_OK && cfg->read_crate)
+        {
+            uint8_t buf[2];
+            bus->result = max17048_i2c_read_regs(bus->dev, MAX17048_CRATE_REG, buf, sizeof(buf), cfg->i2c_timeout_ms);
+            bus->transactions++;
+            if (bus->result == ESP_OK)
+            {
+                max17048_regs_decode_crate(buf, &samples[cell]);
+            }
+        }
+        if (bus->result != ESP_OK)
+        {
+            return;
+        }
+    }
+}
+
+static void max17048_pack_worker(void *arg)
+{
+    max17048_pack_bus_t *bus = (max17048_pack_bus_t *)arg;
+    max17048_pack_handle_t pack = bus->pack;
+
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (pack->stopping)
+        {
+            break;
+        }
+        max17048_pack_sweep_bus(pack, bus, pack->pending);
+        xEventGroupSetBits(pack->done, 1u << bus->index);
+    }
+
+    xEventGroupSetBits(pack->done, 1u << bus->index);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t max17048_pack_start_workers(max17048_pack_handle_t pack)
+{
+    const max17048_pack_config_t *cfg = &pack->config;
+    if (pack->num_buses > MAX17048_PACK_MAX_WORKERS)
+    {
+        ESP_LOGE(TAG, "Parallel sweeps support at most %d buses", MAX17048_PACK_MAX_WORKERS);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pack->done = xEventGroupCreate();
+    if (pack->done == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t b = 0; b < pack->num_buses; b++)
+    {
+        BaseType_t core = cfg->pin_workers ? (BaseType_t)(b % portNUM_PROCESSORS) : tskNO_AFFINITY;
+        if (xTaskCreatePinnedToCore(max17048_pack_worker, "max17048_pack", cfg->worker_stack_size, &pack->buses[b],
+                                    cfg->worker_priority, &pack->buses[b].worker, core) != pdPASS)
+        {
+            pack->buses[b].worker = NULL;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    return ESP_OK;
+}
+
+static void max17048_pack_stop_workers(max17048_pack_handle_t pack)
+{
+    if (pack->done == NULL)
+    {
+        return;
+    }
+
+    EventBits_t running = 0;
+    pack->stopping = true;
+    for (size_t b = 0; b < pack->num_buses; b++)
+    {
+        if (pack->buses[b].worker != NULL)
+        {
+            running |= 1u << b;
+            xTaskNotifyGive(pack->buses[b].worker);
+        }
+    }
+    if (running != 0)
+    {
+        xEventGroupWaitBits(pack->done, running, pdTRUE, pdTRUE, portMAX_DELAY);
+    }
+    vEventGroupDelete(pack->done);
+    pack->done = NULL;
+}
+
+static esp_err_t max17048_pack_sweep_once(max17048_pack_handle_t pack, max17048_snapshot_t *samples, max17048_pack_sweep_info_t *info)
+{
+    if (pack->done != NULL)
+    {
+        // Every bus sweeps its own cells concurrently; the caller waits for all of them
+        EventBits_t all = (1u << pack->num_buses) - 1;
+        pack->pending = samples;
+        xEventGroupClearBits(pack->done, all);
+        for (size_t b = 0; b < pack->num_buses; b++)
+        {
+            xTaskNotifyGive(pack->buses[b].worker);
+        }
+        xEventGroupWaitBits(pack->done, all, pdTRUE, pdTRUE, portMAX_DELAY);
+    }
+    else
+    {
+        for (size_t b = 0; b < pack->num_buses; b++)
+        {
+            max17048_pack_sweep_bus(pack, &pack->buses[b], samples);
+            if (pack->buses[b].result != ESP_OK)
+            {
+                return pack->buses[b].result;
+            }
+        }
+    }
+
+    info->transactions = 0;
+    info->mux_switches = 0;
+    for (size_t b = 0; b < pack->num_buses; b++)
+    {
+        if (pack->buses[b].result != ESP_OK)
+        {
+            return pack->buses[b].result;
+        }
+        info->transactions += pack->buses[b].transactions;
+        info->mux_switches += pack->buses[b].mux_switches;
+    }
+
+    // Buses may run concurrently, so the skew spans the earliest and latest sample of any bus
+    int64_t first = samples[0].timestamp_us;
+    int64_t last = first;
+    for (size_t i = 1; i < pack->config.num_cells; i++)
+    {
+        if (samples[i].timestamp_us < first)
+        {
+            first = samples[i].timestamp_us;
+        }
+        if (samples[i].timestamp_us > last)
+        {
+            last = samples[i].timestamp_us;
+        }
+    }
+    info->skew_us = last - first;
+    return ESP_OK;
+}
+
+// --- Public API Functions ---
+
+void max17048_pack_get_default_config(max17048_pack_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->cells = NULL;           // Must be set by caller
+    config->num_cells = 0;
+    config->device_address = 0x36;  // MAX17048 I2C address
+    config->i2c_freq_hz = 100000;   // 100kHz frequency
+    config->i2c_timeout_ms = 1000;  // 1000ms timeout
+    config->mux_select = NULL;
+    config->mux_user_ctx = NULL;
+    config->max_skew_us = 0;        // No skew bound
+    config->max_retries = 2;
+    config->read_crate = false;
+    config->parallel_buses = false;
+    config->pin_workers = false;
+    config->worker_stack_size = 3072;
+    config->worker_priority = 5;
+}
+
+esp_err_t max17048_pack_create(const max17048_pack_config_t *config, max17048_pack_handle_t *ret_pack)
+{
+    if (config == NULL || ret_pack == NULL || config->cells == NULL || config->num_cells == 0)
+    {
+        ESP_LOGE(TAG, "Invalid pack configuration");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < config->num_cells; i++)
+    {
+        if (config->cells[i].i2c_bus_handle == NULL ||
+            (config->cells[i].mux_channel != MAX17048_PACK_NO_MUX && config->mux_select == NULL))
+        {
+            ESP_LOGE(TAG, "Cell %u has no bus handle or needs a mux_select callback", (unsigned)i);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    struct max17048_pack_t *pack = calloc(1, sizeof(*pack));
+    if (pack == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    pack->config = *config;
+    pack->cells = calloc(config->num_cells, sizeof(*pack->cells));
+    pack->cell_bus = calloc(config->num_cells, sizeof(*pack->cell_bus));
+    pack->order = calloc(config->num_cells, sizeof(*pack->order));
+    pack->buses = calloc(config->num_cells, sizeof(*pack->buses));
+    if (pack->cells == NULL || pack->cell_bus == NULL || pack->order == NULL || pack->buses == NULL)
+    {
+        max17048_pack_delete(pack);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // The gauges share one address, so a single device handle per bus serves every cell on it
+    i2c_device_config_t dev_cfg = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = config->device_address,
+        .scl_speed_hz = config->i2c_freq_hz,
+    };
+    for (size_t i = 0; i < config->num_cells; i++)
+    {
+        pack->cells[i] = config->cells[i];
+
+        size_t b = 0;
+        while (b < pack->num_buses && pack->buses[b].bus != config->cells[i].i2c_bus_handle)
+        {
+            b++;
+        }
+        if (b == pack->num_buses)
+        {
+            esp_err_t err = i2c_master_bus_add_device(config->cells[i].i2c_bus_handle, &dev_cfg, &pack->buses[b].dev);
+            if (err != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to add I2C device: %s", esp_err_to_name(err));
+                max17048_pack_delete(pack);
+                return err;
+            }
+            pack->buses[b].pack = pack;
+            pack->buses[b].index = b;
+            pack->buses[b].bus = config->cells[i].i2c_bus_handle;
+            pack->buses[b].selected_channel = MAX17048_PACK_NO_MUX;
+            pack->num_buses++;
+        }
+        pack->cell_bus[i] = (uint8_t)b;
+    }
+    pack->config.cells = pack->cells;
+
+    // A direct gauge shares the address of every other gauge on its bus and would answer on every channel
+    for (size_t b = 0; b < pack->num_buses; b++)
+    {
+        size_t direct = 0;
+        bool muxed = false;
+        for (size_t i = 0; i < config->num_cells; i++)
+        {
+            if (pack->cell_bus[i] == b)
+            {
+                direct += config->cells[i].mux_channel == MAX17048_PACK_NO_MUX;
+                muxed |= config->cells[i].mux_channel != MAX17048_PACK_NO_MUX;
+            }
+        }
+        if (direct > 1 || (direct > 0 && muxed))
+        {
+            ESP_LOGE(TAG, "Bus %u has a direct gauge alongside other gauges", (unsigned)b);
+            max17048_pack_delete(pack);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    pack->lock = xSemaphoreCreateMutex();
+    if (pack->lock == NULL)
+    {
+        max17048_pack_delete(pack);
+        return ESP_ERR_NO_MEM;
+    }
+
+    max17048_pack_plan(pack);
+
+    if (config->parallel_buses && pack->num_buses > 1)
+    {
+        esp_err_t err = max17048_pack_start_workers(pack);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to start bus workers: %s", esp_err_to_name(err));
+            max17048_pack_delete(pack);
+            return err;
+        }
+    }
+
+    ESP_LOGI(TAG, "Pack created: %u cells on %u bus(es)%s", (unsigned)config->num_cells, (unsigned)pack->num_buses,
+             pack->done != NULL ? ", sampled in parallel" : "");
+    *ret_pack = pack;
+    return ESP_OK;
+}
+
+esp_err_t max17048_pack_delete(max17048_pack_handle_t pack)
+{
+    if (pack == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    max17048_pack_stop_workers(pack);
+    for (size_t b = 0; b < pack->num_buses; b++)
+    {
+        i2c_master_bus_rm_device(pack->buses[b].dev);
+    }
+    if (pack->lock != NULL)
+    {
+        vSemaphoreDelete(pack->lock);
+    }
+    free(pack->buses);
+    free(pack->order);
+    free(pack->cell_bus);
+    free(pack->cells);
+    free(pack);
+    return ESP_OK;
+}
+
+esp_err_t max17048_pack_sweep(max17048_pack_handle_t pack, max17048_snapshot_t *samples, max17048_pack_sweep_info_t *info)
+{
+    if (pack == NULL || samples == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    max17048_pack_sweep_info_t local_info;
+    if (info == NULL)
+    {
+        info = &local_info;
+    }
+
+    uint32_t max_skew_us = pack->config.max_skew_us;
+    esp_err_t err;
+    xSemaphoreTake(pack->lock, portMAX_DELAY);
+    for (info->attempts = 1; ; info->attempts++)
+    {
+        err = max17048_pack_sweep_once(pack, samples, info);
+        if (err != ESP_OK || max_skew_us == 0 || info->skew_us <= max_skew_us)
+        {
+            break;
+        }
+        if (info->attempts > pack->config.max_retries)
+        {
+            ESP_LOGW(TAG, "Sweep skew %lld us exceeds bound %lu us", (long long)info->skew_us, (unsigned long)max_skew_us);
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+    }
+    xSemaphoreGive(pack->lock);
+    return err;
+}
@@ -0,0 +1,420 @@
+#include <stdlib.h>
+#include <string.h>
+#include "max17048_publisher.h"
+#include "max17048_sampler.h"
+#include "max17048_frame.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "MAX17048_PUB";
+
+// Global variables
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_publisher_config_t s_config;
+
+/**
+ * @brief Sealed frame waiting to be sent
+ *
+ * Sealing only hands the buffer over; the task computes the trailer CRC
+ * when it takes the frame, outside the lock.
+ */
+typedef struct {
+    uint16_t slot;                            // Buffer in s_pool
+    bool finished;                            // Trailer written (a frame put back after a failed send)
+    size_t len;                               // Frame length once finished
+    max17048_frame_encoder_t enc;             // Encoder state at sealing
+} max17048_publisher_entry_t;
+
+// Buffers: one being filled, one being sent, queue_len waiting
+static uint8_t *s_pool;
+static uint16_t *s_free;                      // Stack of free buffer indices
+static uint16_t s_free_count;
+static max17048_frame_encoder_t s_enc;        // Frame currently being filled
+static uint16_t s_fill_slot;
+static int64_t s_fill_start_us;
+static max17048_publisher_entry_t *s_queue;
+static uint8_t s_head;
+static uint8_t s_count;
+static bool s_flush_requested;
+static bool s_accepting = false;              // Listener may touch the buffers
+static uint32_t s_base_period_ms;
+static max17048_publisher_stats_t s_stats;
+static TaskHandle_t s_task = NULL;
+static StaticSemaphore_t s_stopped_buf;
+static SemaphoreHandle_t s_stopped = NULL;
+static volatile bool s_stopping = false;
+
+// --- Internal Helper Functions ---
+
+static uint8_t *max17048_publisher_buf(uint16_t slot)
+{
+    return s_pool + (size_t)slot * s_config.max_frame_size;
+}
+
+// Must be called with s_lock held. Queues the filling frame and starts the next one.
+static bool max17048_publisher_seal(void)
+{
+    if (s_enc.count == 0)
+    {
+        return false;
+    }
+
+    if (s_count == s_config.queue_len)
+    {
+        // Link cannot keep up even at the slowest period: lose the oldest data
+        s_free[s_free_count++] = s_queue[s_head].slot;
+        s_head = (s_head + 1) % s_config.queue_len;
+        s_count--;
+        s_stats.frames_dropped++;
+    }
+    max17048_publisher_entry_t *entry = &s_queue[(s_head + s_count) % s_config.queue_len];
+    entry->slot = s_fill_slot;
+    entry->finished = false;
+    entry->enc = s_enc;
+    s_count++;
+
+    s_fill_slot = s_free[--s_free_count];
+    max17048_frame_begin(&s_enc, max17048_publisher_buf(s_fill_slot), s_config.max_frame_size, s_config.device_id);
+    return true;
+}
+
+static void max17048_publisher_on_snapshot(const max17048_snapshot_t *snapshot, void *user_ctx)
+{
+    bool wake = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (!s_accepting)
+    {
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    if (s_enc.count == 0)
+    {
+        // First record of a frame: the task re-arms its age timeout
+        s_fill_start_us = esp_timer_get_time();
+        wake = true;
+    }
+    esp_err_t err = max17048_frame_add(&s_enc, snapshot);
+    if (err == ESP_ERR_NO_MEM)
+    {
+        wake = max17048_publisher_seal();
+        s_fill_start_us = esp_timer_get_time();
+        err = max17048_frame_add(&s_enc, snapshot);
+    }
+    if (err == ESP_OK)
+    {
+        s_stats.snapshots++;
+    }
+    TaskHandle_t task = s_task;
+    portEXIT_CRITICAL(&s_lock);
+
+    if (wake && task != NULL)
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+static void max17048_publisher_adjust_period(bool congested, uint8_t queued)
+{
+    uint32_t period = max17048_sampler_get_period_ms();
+    uint32_t next = period;
+
+    if (congested)
+    {
+        next = period * 2 > s_config.max_period_ms ? s_config.max_period_ms : period * 2;
+    }
+    else if (queued == 0 && period > s_base_period_ms)
+    {
+        next = period / 2 < s_base_period_ms ? s_base_period_ms : period / 2;
+    }
+
+    if (next != period)
+    {
+        ESP_LOGI(TAG, "Sampler period %lu -> %lu ms", (unsigned long)period, (unsigned long)next);
+        max17048_sampler_set_period_ms(next);
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_stats.period_ms = next;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void max17048_publisher_task(void *arg)
+{
+    TickType_t wait = portMAX_DELAY;
+    int64_t retry_at_us = 0;                  // No send before this, whatever woke the task
+
+    while (!s_stopping)
+    {
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (s_stopping)
+        {
+            break;
+        }
+
+        max17048_publisher_entry_t cur;
+        bool sending = false;
+        int64_t now = esp_timer_get_time();
+
+        portENTER_CRITICAL(&s_lock);
+        if (s_flush_requested ||
+            (s_enc.count > 0 && now - s_fill_start_us >= (int64_t)s_config.max_age_ms * 1000))
+        {
+            max17048_publisher_seal();
+            s_flush_requested = false;
+        }
+        if (s_count > 0 && now >= retry_at_us)
+        {
+            // Take the head out of the queue so that sealing never reuses its buffer mid-send
+            cur = s_queue[s_head];
+            s_head = (s_head + 1) % s_config.queue_len;
+            s_count--;
+            sending = true;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        esp_err_t err = ESP_OK;
+        if (sending)
+        {
+            if (!cur.finished)
+            {
+                max17048_frame_finish(&cur.enc, &cur.len);
+                cur.finished = true;
+            }
+
+            // Send outside the lock so the sampler is never blocked by the link
+            int64_t start_us = esp_timer_get_time();
+            err = s_config.send(max17048_publisher_buf(cur.slot), cur.len, s_config.user_ctx);
+            uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+
+            uint8_t queued;
+            portENTER_CRITICAL(&s_lock);
+            if (err == ESP_OK)
+            {
+                s_free[s_free_count++] = cur.slot;
+                s_stats.frames_sent++;
+                s_stats.bytes_sent += cur.len;
+            }
+            else
+            {
+                s_stats.send_errors++;
+                if (s_count < s_config.queue_len)
+                {
+                    // Back at the head for the retry
+                    s_head = (s_head + s_config.queue_len - 1) % s_config.queue_len;
+                    s_queue[s_head] = cur;
+                    s_count++;
+                }
+                else
+                {
+                    s_free[s_free_count++] = cur.slot;
+                    s_stats.frames_dropped++;
+                }
+            }
+            queued = s_count;
+            portEXIT_CRITICAL(&s_lock);
+
+            max17048_publisher_adjust_period(err != ESP_OK || elapsed_ms > s_config.slow_send_ms ||
+                                             queued > s_config.queue_len / 2, queued);
+            if (err != ESP_OK)
+            {
+                ESP_LOGW(TAG, "Send failed: %s", esp_err_to_name(err));
+                retry_at_us = esp_timer_get_time() + (int64_t)s_config.retry_ms * 1000;
+            }
+        }
+
+        // Next wake: the earlier of the next allowed send for a backlog and the frame expiry
+        portENTER_CRITICAL(&s_lock);
+        bool backlog = s_count > 0;
+        bool filling = s_enc.count > 0;
+        int64_t expiry_us = s_fill_start_us + (int64_t)s_config.max_age_ms * 1000;
+        portEXIT_CRITICAL(&s_lock);
+
+        now = esp_timer_get_time();
+        int64_t due_us = INT64_MAX;
+        if (backlog)
+        {
+            due_us = retry_at_us > now ? retry_at_us : now;
+        }
+        if (filling && expiry_us < due_us)
+        {
+            due_us = expiry_us;
+        }
+        if (due_us == INT64_MAX)
+        {
+            // Nothing buffered: the first snapshot of the next frame wakes the task
+            wait = portMAX_DELAY;
+        }
+        else
+        {
+            int64_t left_ms = (due_us - now + 999) / 1000;
+            wait = left_ms > 0 ? pdMS_TO_TICKS((uint32_t)left_ms) : 0;
+        }
+    }
+
+    xSemaphoreGive(s_stopped);
+    vTaskDelete(NULL);
+}
+
+static void max17048_publisher_free(void)
+{
+    free(s_pool);
+    free(s_free);
+    free(s_queue);
+    s_pool = NULL;
+    s_free = NULL;
+    s_queue = NULL;
+}
+
+// --- Public API Functions ---
+
+void max17048_publisher_get_default_config(max17048_publisher_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->send = NULL;            // Must be set by caller
+    config->user_ctx = NULL;
+    config->device_id = 0;
+    config->max_frame_size = 512;
+    config->max_age_ms = 60000;
+    config->queue_len = 4;
+    config->slow_send_ms = 2000;
+    config->retry_ms = 5000;
+    config->max_period_ms = 60000;
+    config->task_stack_size = 4096;
+    config->task_priority = 4;
+}
+
+esp_err_t max17048_publisher_start(const max17048_publisher_config_t *config)
+{
+    if (config == NULL || config->send == NULL || config->queue_len == 0 || config->max_age_ms == 0 ||
+        config->max_frame_size < MAX17048_FRAME_HEADER_SIZE + MAX17048_FRAME_MAX_RECORD_SIZE + MAX17048_FRAME_TRAILER_SIZE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task != NULL)
+    {
+        ESP_LOGW(TAG, "Publisher already running.");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_base_period_ms = max17048_sampler_get_period_ms();
+    if (s_base_period_ms == 0)
+    {
+        ESP_LOGE(TAG, "Sampler must be started first");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    if (s_config.max_period_ms < s_base_period_ms)
+    {
+        s_config.max_period_ms = s_base_period_ms;
+    }
+    size_t slots = (size_t)config->queue_len + 2;
+    s_pool = malloc(slots * config->max_frame_size);
+    s_free = malloc(slots * sizeof(uint16_t));
+    s_queue = calloc(config->queue_len, sizeof(max17048_publisher_entry_t));
+    if (s_pool == NULL || s_free == NULL || s_queue == NULL)
+    {
+        max17048_publisher_free();
+        return ESP_ERR_NO_MEM;
+    }
+    if (s_stopped == NULL)
+    {
+        s_stopped = xSemaphoreCreateBinaryStatic(&s_stopped_buf);
+    }
+
+    // Slot 0 is filled first; the rest start free
+    s_free_count = 0;
+    for (size_t i = slots - 1; i > 0; i--)
+    {
+        s_free[s_free_count++] = (uint16_t)i;
+    }
+    s_fill_slot = 0;
+    max17048_frame_begin(&s_enc, max17048_publisher_buf(0), config->max_frame_size, config->device_id);
+    s_head = 0;
+    s_count = 0;
+    s_flush_requested = false;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.period_ms = s_base_period_ms;
+    s_stopping = false;
+
+    if (xTaskCreate(max17048_publisher_task, "max17048_pub", config->task_stack_size, NULL,
+                    config->task_priority, &s_task) != pdPASS)
+    {
+        s_task = NULL;
+        max17048_publisher_free();
+        ESP_LOGE(TAG, "Failed to create publisher task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_accepting = true;
+    portEXIT_CRITICAL(&s_lock);
+
+    esp_err_t ret = max17048_sampler_add_listener(max17048_publisher_on_snapshot, NULL);
+    if (ret != ESP_OK)
+    {
+        max17048_publisher_stop();
+        return ret;
+    }
+    return ESP_OK;
+}
+
+esp_err_t max17048_publisher_stop(void)
+{
+    if (s_task == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Waits for a snapshot callback in progress; the flag covers the failed-start path
+    esp_err_t ret = max17048_sampler_remove_listener(max17048_publisher_on_snapshot, NULL);
+    if (ret == ESP_ERR_INVALID_STATE)
+    {
+        return ret;
+    }
+    portENTER_CRITICAL(&s_lock);
+    s_accepting = false;
+    portEXIT_CRITICAL(&s_lock);
+
+    s_stopping = true;
+    xTaskNotifyGive(s_task);
+    xSemaphoreTake(s_stopped, portMAX_DELAY);
+    s_task = NULL;
+
+    max17048_sampler_set_period_ms(s_base_period_ms);
+    max17048_publisher_free();
+    return ESP_OK;
+}
+
+esp_err_t max17048_publisher_flush(void)
+{
+    if (s_task == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_flush_requested = true;
+    portEXIT_CRITICAL(&s_lock);
+    xTaskNotifyGive(s_task);
+    return ESP_OK;
+}
+
+void max17048_publisher_get_stats(max17048_publisher_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
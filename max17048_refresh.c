@@ -0,0 +1,245 @@
+#include <string.h>
+#include "max17048_refresh.h"
+#include "max17048_priv.h"
+
+// Register addresses by max17048_refresh_reg_t; 0x0E-0x13 (OCV, reserved) are never read through
+static const uint8_t s_addr[MAX17048_REFRESH_REG_MAX] = {
+    MAX17048_VCELL_REG, MAX17048_SOC_REG, MAX17048_MODE_REG, MAX17048_VERSION_REG, MAX17048_HIBRT_REG,
+    MAX17048_CONFIG_REG, MAX17048_VALRT_REG, MAX17048_CRATE_REG, MAX17048_VRESET_ID_REG, MAX17048_STATUS_REG,
+};
+
+#define MAX17048_REFRESH_ALL ((uint16_t)((1u << MAX17048_REFRESH_REG_MAX) - 1))
+#define MAX17048_REFRESH_MAX_BURST_LEN 12     // 0x02-0x0D
+
+// --- Internal Helper Functions ---
+
+static size_t max17048_refresh_plan_mask(uint16_t mask, max17048_refresh_burst_t *bursts)
+{
+    size_t count = 0;
+    int last = -1;                            // Last register in the open burst
+
+    for (int i = 0; i < MAX17048_REFRESH_REG_MAX; i++)
+    {
+        if (!(mask & (1u << i)))
+        {
+            continue;
+        }
+        if (last >= 0)
+        {
+            // Read through skipped registers only if they are adjacent and cheaper than a new transaction
+            uint8_t end = s_addr[last] + 2;
+            uint8_t gap = s_addr[i] - end;
+            if (gap == 2 * (i - last - 1) && gap < MAX17048_REFRESH_TXN_OVERHEAD)
+            {
+                bursts[count - 1].len = s_addr[i] + 2 - bursts[count - 1].reg;
+                last = i;
+                continue;
+            }
+        }
+        bursts[count].reg = s_addr[i];
+        bursts[count].len = 2;
+        count++;
+        last = i;
+    }
+    return count;
+}
+
+static uint32_t max17048_refresh_bus_bytes(const max17048_refresh_burst_t *bursts, size_t count)
+{
+    uint32_t bytes = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        bytes += bursts[i].len + MAX17048_REFRESH_TXN_OVERHEAD;
+    }
+    return bytes;
+}
+
+static uint16_t max17048_refresh_due(const max17048_refresh_t *planner, int64_t now_us)
+{
+    uint16_t mask = 0;
+    for (int i = 0; i < MAX17048_REFRESH_REG_MAX; i++)
+    {
+        if (planner->next_due_us[i] <= now_us)
+        {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+// --- Public API Functions ---
+
+esp_err_t max17048_refresh_init(max17048_refresh_t *planner, const uint32_t interval_ms[MAX17048_REFRESH_REG_MAX])
+{
+    if (planner == NULL || interval_ms == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(planner, 0, sizeof(*planner));
+    for (int i = 0; i < MAX17048_REFRESH_REG_MAX; i++)
+    {
+        planner->interval_ms[i] = interval_ms[i];
+        planner->next_due_us[i] = interval_ms[i] != 0 ? INT64_MIN : INT64_MAX;
+        planner->updated_us[i] = -1;
+    }
+    return ESP_OK;
+}
+
+void max17048_refresh_set_interval(max17048_refresh_t *planner, max17048_refresh_reg_t reg, uint32_t interval_ms,
+                                   int64_t now_us)
+{
+    if (planner == NULL || reg >= MAX17048_REFRESH_REG_MAX)
+    {
+        return;
+    }
+
+    planner->interval_ms[reg] = interval_ms;
+    if (interval_ms == 0)
+    {
+        planner->next_due_us[reg] = INT64_MAX;
+    }
+    else if (planner->updated_us[reg] < 0 || planner->updated_us[reg] + (int64_t)interval_ms * 1000 <= now_us)
+    {
+        planner->next_due_us[reg] = now_us;
+    }
+    else
+    {
+        planner->next_due_us[reg] = planner->updated_us[reg] + (int64_t)interval_ms * 1000;
+    }
+}
+
+void max17048_refresh_request(max17048_refresh_t *planner, max17048_refresh_reg_t reg)
+{
+    if (planner != NULL && reg < MAX17048_REFRESH_REG_MAX)
+    {
+        planner->next_due_us[reg] = INT64_MIN;
+    }
+}
+
+size_t max17048_refresh_plan(const max17048_refresh_t *planner, int64_t now_us, max17048_refresh_burst_t *bursts,
+                             uint16_t *due_mask)
+{
+    uint16_t mask = max17048_refresh_due(planner, now_us);
+    if (due_mask != NULL)
+    {
+        *due_mask = mask;
+    }
+    return max17048_refresh_plan_mask(mask, bursts);
+}
+
+esp_err_t max17048_refresh_tick(max17048_refresh_t *planner, int64_t now_us, uint16_t *updated_mask)
+{
+    if (planner == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    max17048_refresh_burst_t bursts[MAX17048_REFRESH_MAX_BURSTS];
+    uint16_t due;
+    size_t count = max17048_refresh_plan(planner, now_us, bursts, &due);
+    uint16_t updated = 0;
+    esp_err_t ret = ESP_OK;
+
+    for (size_t b = 0; b < count && ret == ESP_OK; b++)
+    {
+        uint8_t buf[MAX17048_REFRESH_MAX_BURST_LEN];
+        ret = max17048_read_burst(bursts[b].reg, buf, bursts[b].len);
+        if (ret != ESP_OK)
+        {
+            break;
+        }
+        // Registers read through in a gap are refreshed too
+        for (int i = 0; i < MAX17048_REFRESH_REG_MAX; i++)
+        {
+            if (s_addr[i] >= bursts[b].reg && s_addr[i] < bursts[b].reg + bursts[b].len)
+            {
+                const uint8_t *p = &buf[s_addr[i] - bursts[b].reg];
+                planner->value[i] = (uint16_t)((p[0] << 8) | p[1]);
+                planner->updated_us[i] = now_us;
+                updated |= 1u << i;
+            }
+        }
+    }
+
+    for (int i = 0; i < MAX17048_REFRESH_REG_MAX; i++)
+    {
+        // Failed registers stay due and are retried on the next tick
+        if (due & updated & (1u << i))
+        {
+            planner->next_due_us[i] = planner->interval_ms[i] != 0 ?
+                                      now_us + (int64_t)planner->interval_ms[i] * 1000 : INT64_MAX;
+        }
+    }
+
+    if (count > 0)
+    {
+        max17048_refresh_burst_t all[MAX17048_REFRESH_MAX_BURSTS];
+        uint32_t full = max17048_refresh_bus_bytes(all, max17048_refresh_plan_mask(MAX17048_REFRESH_ALL, all));
+        uint32_t used = max17048_refresh_bus_bytes(bursts, count);
+        planner->stats.ticks++;
+        planner->stats.transactions += count;
+        planner->stats.bus_bytes += used;
+        planner->stats.bus_bytes_saved += full > used ? full - used : 0;
+    }
+    if (updated_mask != NULL)
+    {
+        *updated_mask = updated;
+    }
+    return ret;
+}
+
+int64_t max17048_refresh_next_due(const max17048_refresh_t *planner)
+{
+    int64_t next = INT64_MAX;
+    for (int i = 0; i < MAX17048_REFRESH_REG_MAX; i++)
+    {
+        if (planner->next_due_us[i] < next)
+        {
+            next = planner->next_due_us[i];
+        }
+    }
+    return next;
+}
+
+esp_err_t max17048_refresh_get(const max17048_refresh_t *planner, max17048_refresh_reg_t reg, uint16_t *value)
+{
+    if (planner == NULL || reg >= MAX17048_REFRESH_REG_MAX || value == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (planner->updated_us[reg] < 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *value = planner->value[reg];
+    return ESP_OK;
+}
+
+esp_err_t max17048_refresh_get_snapshot(const max17048_refresh_t *planner, max17048_snapshot_t *snapshot)
+{
+    if (planner == NULL || snapshot == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    static const max17048_refresh_reg_t fields[] = {
+        MAX17048_REFRESH_VCELL, MAX17048_REFRESH_SOC, MAX17048_REFRESH_CRATE,
+    };
+    int64_t latest = -1;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        int64_t t = planner->updated_us[fields[i]];
+        if (t < 0)
+        {
+            return ESP_ERR_NOT_FOUND;
+        }
+        latest = t > latest ? t : latest;
+    }
+
+    snapshot->vcell = planner->value[MAX17048_REFRESH_VCELL];
+    snapshot->soc = planner->value[MAX17048_REFRESH_SOC];
+    snapshot->crate = (int16_t)planner->value[MAX17048_REFRESH_CRATE];
+    snapshot->timestamp_us = latest;
+    return ESP_OK;
+}
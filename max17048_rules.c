@@ -0,0 +1,181 @@
+#include <math.h>
+#include <string.h>
+#include "max17048_rules.h"
+#include "max17048_priv.h"
+
+// --- Internal Helper Functions ---
+
+#define MAX17048_RULES_UNITS_MAX 1e12         // Clamp before the cast; far outside every register range
+
+// Exact LSB as num / den micro-units (uV, u%, u%/hr), matching the max17048_regs_* helpers
+static void max17048_rules_lsb(max17048_field_t field, int64_t *num, int64_t *den)
+{
+    switch (field)
+    {
+    case MAX17048_FIELD_VCELL:
+        // Thresholds are in volts of the measured stack, like max17048_get_voltage()
+        *num = 625 * (int64_t)max17048_get_variant();
+        *den = 8;
+        break;
+    case MAX17048_FIELD_SOC:
+        *num = 15625;                         // 1/256 % = 15625/4 u%
+        *den = 4;
+        break;
+    default:
+        *num = 208000;                        // 0.208 %/hr
+        *den = 1;
+        break;
+    }
+}
+
+static int64_t max17048_rules_floor_div(int64_t a, int64_t b)
+{
+    int64_t q = a / b;
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+static int32_t max17048_rules_field(const max17048_snapshot_t *snapshot, uint8_t field)
+{
+    switch (field)
+    {
+    case MAX17048_FIELD_VCELL:
+        return snapshot->vcell;
+    case MAX17048_FIELD_SOC:
+        return snapshot->soc;
+    default:
+        return snapshot->crate;
+    }
+}
+
+// --- Public API Functions ---
+
+esp_err_t max17048_rules_init(max17048_rules_t *engine, max17048_rule_t *storage, size_t capacity)
+{
+    if (engine == NULL || storage == NULL || capacity == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    engine->rules = storage;
+    engine->capacity = capacity;
+    engine->count = 0;
+    return ESP_OK;
+}
+
+esp_err_t max17048_rules_add(max17048_rules_t *engine, const max17048_rule_def_t *def, size_t *ret_index)
+{
+    if (engine == NULL || def == NULL || def->cb == NULL ||
+        def->num_conds == 0 || def->num_conds > MAX17048_RULE_MAX_CONDS)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (engine->count == engine->capacity)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    max17048_rule_t rule;
+    memset(&rule, 0, sizeof(rule));
+    for (size_t i = 0; i < def->num_conds; i++)
+    {
+        const max17048_rule_cond_t *cond = &def->conds[i];
+        if (cond->field >= MAX17048_FIELD_MAX)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        // Round the threshold to micro-units, so 3.3f (3.2999999 V) means 3300000 uV, then
+        // compare exactly: raw * num < T * den == raw < ceil(T * den / num), and so on
+        double units = (double)cond->threshold * 1e6;
+        if (isnan(units))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        units = units > MAX17048_RULES_UNITS_MAX ? MAX17048_RULES_UNITS_MAX : units;
+        units = units < -MAX17048_RULES_UNITS_MAX ? -MAX17048_RULES_UNITS_MAX : units;
+        int64_t num, den;
+        max17048_rules_lsb(cond->field, &num, &den);
+        int64_t scaled = llround(units) * den;
+        int64_t floor_raw = max17048_rules_floor_div(scaled, num);
+        int64_t ceil_raw = -max17048_rules_floor_div(-scaled, num);
+
+        int64_t threshold;
+        switch (cond->op)
+        {
+        case MAX17048_RULE_LT:
+            threshold = ceil_raw;
+            rule.below |= 1u << i;
+            break;
+        case MAX17048_RULE_LE:
+            threshold = floor_raw + 1;
+            rule.below |= 1u << i;
+            break;
+        case MAX17048_RULE_GT:
+            threshold = floor_raw + 1;
+            break;
+        case MAX17048_RULE_GE:
+            threshold = ceil_raw;
+            break;
+        default:
+            return ESP_ERR_INVALID_ARG;
+        }
+        // Registers are 16 bits; anything beyond this range compares the same
+        threshold = threshold > 0x20000 ? 0x20000 : threshold;
+        rule.threshold[i] = (int32_t)(threshold < -0x20000 ? -0x20000 : threshold);
+        rule.field[i] = (uint8_t)cond->field;
+    }
+    rule.num_conds = (uint8_t)def->num_conds;
+    rule.hold_us = (int64_t)def->hold_ms * 1000;
+    rule.cb = def->cb;
+    rule.user_ctx = def->user_ctx;
+
+    engine->rules[engine->count] = rule;
+    if (ret_index != NULL)
+    {
+        *ret_index = engine->count;
+    }
+    engine->count++;
+    return ESP_OK;
+}
+
+void max17048_rules_eval(max17048_rules_t *engine, const max17048_snapshot_t *snapshot)
+{
+    for (size_t r = 0; r < engine->count; r++)
+    {
+        max17048_rule_t *rule = &engine->rules[r];
+
+        bool match = true;
+        for (uint8_t i = 0; i < rule->num_conds && match; i++)
+        {
+            bool below = max17048_rules_field(snapshot, rule->field[i]) < rule->threshold[i];
+            match = below == ((rule->below >> i) & 1);
+        }
+
+        if (!match)
+        {
+            rule->holding = false;
+            if (rule->active)
+            {
+                rule->active = false;
+                rule->cb(r, false, snapshot, rule->user_ctx);
+            }
+            continue;
+        }
+
+        if (!rule->holding)
+        {
+            rule->holding = true;
+            rule->since_us = snapshot->timestamp_us;
+        }
+        if (!rule->active && snapshot->timestamp_us - rule->since_us >= rule->hold_us)
+        {
+            rule->active = true;
+            rule->cb(r, true, snapshot, rule->user_ctx);
+        }
+    }
+}
+
+void max17048_rules_sampler_cb(const max17048_snapshot_t *snapshot, void *engine)
+{
+    max17048_rules_eval((max17048_rules_t *)engine, snapshot);
+}
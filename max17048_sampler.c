@@ -0,0 +1,323 @@
+#include <string.h>
+#include "max17048_sampler.h"
+#include "max17048_priv.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "MAX17048_SAMPLER";
+
+typedef struct {
+    max17048_sampler_cb_t cb;
+    void *user_ctx;
+} max17048_sampler_listener_t;
+
+// Global variables
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_sampler_listener_t s_listeners[MAX17048_SAMPLER_MAX_LISTENERS];
+static max17048_sampler_listener_t s_raw_listeners[MAX17048_SAMPLER_MAX_RAW_LISTENERS];
+static max17048_filter_t *s_filters[MAX17048_FIELD_MAX];
+static max17048_snapshot_t s_latest;
+static bool s_has_latest = false;
+static volatile uint32_t s_period_ms;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_stopping = false;
+static StaticSemaphore_t s_dispatch_buf;
+static SemaphoreHandle_t s_dispatch = NULL;   // Held while listeners run; removal waits on it
+static StaticSemaphore_t s_stopped_buf;
+static SemaphoreHandle_t s_stopped = NULL;    // Given by the task when it exits
+
+// --- Internal Helper Functions ---
+
+static void max17048_sampler_init_locks(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (s_dispatch == NULL)
+    {
+        s_dispatch = xSemaphoreCreateMutexStatic(&s_dispatch_buf);
+        s_stopped = xSemaphoreCreateBinaryStatic(&s_stopped_buf);
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static void max17048_sampler_dispatch(const max17048_sampler_listener_t *table, const max17048_snapshot_t *snapshot)
+{
+    for (int i = 0; i < MAX17048_SAMPLER_MAX_LISTENERS && table[i].cb != NULL; i++)
+    {
+        table[i].cb(snapshot, table[i].user_ctx);
+    }
+}
+
+static esp_err_t max17048_sampler_add(max17048_sampler_listener_t *table, size_t size, max17048_sampler_cb_t cb,
+                                      void *user_ctx)
+{
+    if (cb == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_lock);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (table[i].cb == NULL)
+        {
+            table[i].cb = cb;
+            table[i].user_ctx = user_ctx;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+static esp_err_t max17048_sampler_remove(max17048_sampler_listener_t *table, size_t size, max17048_sampler_cb_t cb,
+                                         void *user_ctx)
+{
+    // Waiting for the dispatch from inside it would never return
+    if (s_task != NULL && xTaskGetCurrentTaskHandle() == s_task)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    max17048_sampler_init_locks();
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_lock);
+    for (size_t i = 0; i < size; i++)
+    {
+        if (table[i].cb == cb && table[i].user_ctx == user_ctx)
+        {
+            // Keep the table packed so dispatch can stop at the first hole
+            memmove(&table[i], &table[i + 1], (size - 1 - i) * sizeof(table[0]));
+            table[size - 1].cb = NULL;
+            table[size - 1].user_ctx = NULL;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret == ESP_OK)
+    {
+        // A dispatch that copied the table before the removal finishes before this returns
+        xSemaphoreTake(s_dispatch, portMAX_DELAY);
+        xSemaphoreGive(s_dispatch);
+    }
+    return ret;
+}
+
+static bool max17048_sampler_filter(max17048_filter_t *const filters[MAX17048_FIELD_MAX], max17048_snapshot_t *snapshot)
+{
+    int32_t value[MAX17048_FIELD_MAX] = {
+        [MAX17048_FIELD_VCELL] = snapshot->vcell,
+        [MAX17048_FIELD_SOC] = snapshot->soc,
+        [MAX17048_FIELD_CRATE] = snapshot->crate,
+    };
+
+    bool deliver = true;
+    for (int field = 0; field < MAX17048_FIELD_MAX; field++)
+    {
+        // Every pipeline sees every sample so that decimators stay in step
+        if (filters[field] != NULL && !max17048_filter_process(filters[field], value[field], &value[field]))
+        {
+            deliver = false;
+        }
+    }
+
+    snapshot->vcell = (uint16_t)value[MAX17048_FIELD_VCELL];
+    snapshot->soc = (uint16_t)value[MAX17048_FIELD_SOC];
+    snapshot->crate = (int16_t)value[MAX17048_FIELD_CRATE];
+    return deliver;
+}
+
+static void max17048_sampler_task(void *arg)
+{
+    TickType_t next_wake = xTaskGetTickCount();
+
+    while (!s_stopping)
+    {
+        max17048_snapshot_t snapshot;
+        esp_err_t err = max17048_read_snapshot(&snapshot);
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Snapshot read failed: %s", esp_err_to_name(err));
+        }
+        else
+        {
+            max17048_filter_t *filters[MAX17048_FIELD_MAX];
+            max17048_sampler_listener_t raw[MAX17048_SAMPLER_MAX_LISTENERS] = { 0 };
+            max17048_sampler_listener_t listeners[MAX17048_SAMPLER_MAX_LISTENERS];
+
+            xSemaphoreTake(s_dispatch, portMAX_DELAY);
+            portENTER_CRITICAL(&s_lock);
+            memcpy(filters, s_filters, sizeof(filters));
+            memcpy(raw, s_raw_listeners, sizeof(s_raw_listeners));
+            portEXIT_CRITICAL(&s_lock);
+
+            max17048_sampler_dispatch(raw, &snapshot);
+
+            if (max17048_sampler_filter(filters, &snapshot))
+            {
+                portENTER_CRITICAL(&s_lock);
+                s_latest = snapshot;
+                s_has_latest = true;
+                memcpy(listeners, s_listeners, sizeof(listeners));
+                portEXIT_CRITICAL(&s_lock);
+
+                max17048_sampler_dispatch(listeners, &snapshot);
+            }
+            xSemaphoreGive(s_dispatch);
+        }
+
+        // Sleep until the next period, waking early when asked to stop
+        next_wake += pdMS_TO_TICKS(s_period_ms);
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(next_wake - now) <= 0)
+        {
+            next_wake = now;
+        }
+        else
+        {
+            ulTaskNotifyTake(pdTRUE, next_wake - now);
+        }
+    }
+
+    xSemaphoreGive(s_stopped);
+    vTaskDelete(NULL);
+}
+
+// --- Public API Functions ---
+
+void max17048_sampler_get_default_config(max17048_sampler_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->period_ms = 1000;             // 1 Hz
+    config->task_stack_size = 3072;
+    config->task_priority = 5;
+    config->task_core_id = tskNO_AFFINITY;
+}
+
+esp_err_t max17048_sampler_start(const max17048_sampler_config_t *config)
+{
+    if (config == NULL || config->period_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task != NULL)
+    {
+        ESP_LOGW(TAG, "Sampler already running.");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    max17048_sampler_init_locks();
+    s_period_ms = config->period_ms;
+    s_stopping = false;
+    if (xTaskCreatePinnedToCore(max17048_sampler_task, "max17048_sampler", config->task_stack_size, NULL,
+                                config->task_priority, &s_task, config->task_core_id) != pdPASS)
+    {
+        s_task = NULL;
+        ESP_LOGE(TAG, "Failed to create sampler task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t max17048_sampler_stop(void)
+{
+    if (s_task == NULL || xTaskGetCurrentTaskHandle() == s_task)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_stopping = true;
+    xTaskNotifyGive(s_task);
+    xSemaphoreTake(s_stopped, portMAX_DELAY);
+    s_task = NULL;
+
+    portENTER_CRITICAL(&s_lock);
+    s_has_latest = false;
+    portEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t max17048_sampler_set_period_ms(uint32_t period_ms)
+{
+    if (period_ms == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Takes effect from the next period
+    s_period_ms = period_ms;
+    return ESP_OK;
+}
+
+uint32_t max17048_sampler_get_period_ms(void)
+{
+    return s_period_ms;
+}
+
+esp_err_t max17048_sampler_add_listener(max17048_sampler_cb_t cb, void *user_ctx)
+{
+    return max17048_sampler_add(s_listeners, MAX17048_SAMPLER_MAX_LISTENERS, cb, user_ctx);
+}
+
+esp_err_t max17048_sampler_remove_listener(max17048_sampler_cb_t cb, void *user_ctx)
+{
+    return max17048_sampler_remove(s_listeners, MAX17048_SAMPLER_MAX_LISTENERS, cb, user_ctx);
+}
+
+esp_err_t max17048_sampler_add_raw_listener(max17048_sampler_cb_t cb, void *user_ctx)
+{
+    return max17048_sampler_add(s_raw_listeners, MAX17048_SAMPLER_MAX_RAW_LISTENERS, cb, user_ctx);
+}
+
+esp_err_t max17048_sampler_remove_raw_listener(max17048_sampler_cb_t cb, void *user_ctx)
+{
+    return max17048_sampler_remove(s_raw_listeners, MAX17048_SAMPLER_MAX_RAW_LISTENERS, cb, user_ctx);
+}
+
+esp_err_t max17048_sampler_set_filter(max17048_field_t field, max17048_filter_t *filter)
+{
+    if (field >= MAX17048_FIELD_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_filters[field] = filter;
+    portEXIT_CRITICAL(&s_lock);
+
+    // Let a dispatch still using the previous pipeline finish
+    if (s_task != NULL && xTaskGetCurrentTaskHandle() != s_task)
+    {
+        xSemaphoreTake(s_dispatch, portMAX_DELAY);
+        xSemaphoreGive(s_dispatch);
+    }
+    return ESP_OK;
+}
+
+esp_err_t max17048_sampler_get_latest(max17048_snapshot_t *snapshot)
+{
+    if (snapshot == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_lock);
+    if (s_has_latest)
+    {
+        *snapshot = s_latest;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    max17048_stats_cache_access(ret == ESP_OK);
+    return ret;
+}
@@ -0,0 +1,453 @@
+#include <string.h>
+#include "max17048_sub.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+static const char *TAG = "MAX17048_SUB";
+
+typedef struct {
+    bool used;
+    bool has_last;
+    bool pending;                             // Notified update not fetched yet
+    max17048_sub_config_t config;
+    int64_t next_us;                          // Next due check
+    max17048_sub_update_t latest;             // Last delivery, compared against and fetched by notified tasks
+    max17048_sub_counters_t counters;
+} max17048_sub_t;
+
+typedef struct {
+    max17048_sub_cb_t cb;
+    void *user_ctx;
+    TaskHandle_t notify_task;
+    uint32_t notify_bits;
+    max17048_sub_update_t update;
+} max17048_sub_delivery_t;
+
+// Global variables
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_sub_t s_subs[MAX17048_SUB_MAX];
+static bool s_dirty = true;                   // Subscriptions changed since the schedule was merged
+static max17048_refresh_t s_planner;          // Owned by the service task
+static max17048_sub_stats_t s_stats;
+static TaskHandle_t s_task = NULL;
+static StaticSemaphore_t s_stopped_buf;
+static SemaphoreHandle_t s_stopped = NULL;    // Given by the service task as it exits
+static volatile bool s_stopping = false;
+
+// --- Internal Helper Functions ---
+
+// Must be called with s_lock held
+static void max17048_sub_merge(uint32_t interval_ms[MAX17048_REFRESH_REG_MAX])
+{
+    memset(interval_ms, 0, sizeof(uint32_t) * MAX17048_REFRESH_REG_MAX);
+    for (int s = 0; s < MAX17048_SUB_MAX; s++)
+    {
+        if (!s_subs[s].used)
+        {
+            continue;
+        }
+        for (int reg = 0; reg < MAX17048_REFRESH_REG_MAX; reg++)
+        {
+            uint32_t staleness = s_subs[s].config.max_staleness_ms;
+            if ((s_subs[s].config.fields & MAX17048_SUB_FIELD(reg)) &&
+                (interval_ms[reg] == 0 || staleness < interval_ms[reg]))
+            {
+                interval_ms[reg] = staleness;
+            }
+        }
+    }
+}
+
+static uint16_t max17048_sub_changed(const max17048_sub_t *sub, const uint16_t *value)
+{
+    uint16_t changed = 0;
+    for (int reg = 0; reg < MAX17048_REFRESH_REG_MAX; reg++)
+    {
+        if (!(sub->config.fields & MAX17048_SUB_FIELD(reg)))
+        {
+            continue;
+        }
+        // CRATE is signed; every other register is compared as unsigned
+        int32_t delta = reg == MAX17048_REFRESH_CRATE ? (int16_t)value[reg] - (int16_t)sub->latest.value[reg]
+                                                      : (int32_t)value[reg] - (int32_t)sub->latest.value[reg];
+        if (!sub->has_last || delta > sub->config.deadband[reg] || -delta > sub->config.deadband[reg])
+        {
+            changed |= MAX17048_SUB_FIELD(reg);
+        }
+    }
+    return changed;
+}
+
+static uint16_t max17048_sub_state(const max17048_sub_t *sub, const uint16_t *value)
+{
+    uint16_t state = 0;
+    if (sub->config.fields & MAX17048_SUB_FIELD(MAX17048_REFRESH_CRATE))
+    {
+        int16_t crate = (int16_t)value[MAX17048_REFRESH_CRATE];
+        if (crate > (int32_t)sub->config.crate_idle)
+        {
+            state |= MAX17048_SUB_STATE_CHARGING;
+        }
+        else if (crate < -(int32_t)sub->config.crate_idle)
+        {
+            state |= MAX17048_SUB_STATE_DISCHARGING;
+        }
+    }
+    if (sub->config.fields & MAX17048_SUB_FIELD(MAX17048_REFRESH_STATUS))
+    {
+        state |= value[MAX17048_REFRESH_STATUS] & MAX17048_SUB_STATE_ALERTS;
+    }
+    return state;
+}
+
+// Collects due deliveries and returns the next time any subscriber is due
+static size_t max17048_sub_collect(int64_t now_us, max17048_sub_delivery_t *out, int64_t *next_us)
+{
+    size_t count = 0;
+    *next_us = INT64_MAX;
+
+    portENTER_CRITICAL(&s_lock);
+    for (int s = 0; s < MAX17048_SUB_MAX; s++)
+    {
+        max17048_sub_t *sub = &s_subs[s];
+        if (!sub->used)
+        {
+            continue;
+        }
+        bool ready = true;
+        for (int reg = 0; reg < MAX17048_REFRESH_REG_MAX; reg++)
+        {
+            if ((sub->config.fields & MAX17048_SUB_FIELD(reg)) && s_planner.updated_us[reg] < 0)
+            {
+                ready = false;
+            }
+        }
+        if (ready && now_us >= sub->next_us)
+        {
+            uint16_t changed = max17048_sub_changed(sub, s_planner.value);
+            uint16_t state = max17048_sub_state(sub, s_planner.value);
+            bool deliver = !sub->has_last || sub->config.mode == MAX17048_SUB_PERIODIC ||
+                           (sub->config.mode == MAX17048_SUB_ON_CHANGE && changed != 0) ||
+                           (sub->config.mode == MAX17048_SUB_ON_STATE && state != sub->latest.state);
+            if (deliver)
+            {
+                max17048_sub_delivery_t *d = &out[count++];
+                d->cb = sub->config.cb;
+                d->user_ctx = sub->config.user_ctx;
+                d->notify_task = sub->config.notify_task;
+                d->notify_bits = sub->config.notify_bits;
+                d->update.fields = sub->config.fields;
+                d->update.changed = changed;
+                d->update.state = state;
+                d->update.timestamp_us = now_us;
+                memcpy(d->update.value, s_planner.value, sizeof(d->update.value));
+                sub->has_last = true;
+                sub->latest = d->update;
+                sub->counters.delivered++;
+                if (d->cb == NULL)
+                {
+                    // The task is woken once however many updates arrive before it fetches
+                    if (sub->pending)
+                    {
+                        sub->counters.coalesced++;
+                    }
+                    sub->pending = true;
+                }
+            }
+            else
+            {
+                sub->counters.suppressed++;
+                s_stats.suppressed++;
+            }
+            sub->next_us = now_us + (int64_t)sub->config.max_staleness_ms * 1000;
+        }
+        if (sub->next_us < *next_us)
+        {
+            *next_us = sub->next_us;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return count;
+}
+
+static void max17048_sub_task(void *arg)
+{
+    while (!s_stopping)
+    {
+        int64_t now = esp_timer_get_time();
+        uint32_t merged[MAX17048_REFRESH_REG_MAX];
+        bool dirty;
+
+        portENTER_CRITICAL(&s_lock);
+        dirty = s_dirty;
+        s_dirty = false;
+        if (dirty)
+        {
+            max17048_sub_merge(merged);
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        if (dirty)
+        {
+            for (int reg = 0; reg < MAX17048_REFRESH_REG_MAX; reg++)
+            {
+                if (merged[reg] != s_planner.interval_ms[reg])
+                {
+                    max17048_refresh_set_interval(&s_planner, reg, merged[reg], now);
+                }
+            }
+        }
+
+        // One refresh serves every subscriber of a register
+        esp_err_t err = max17048_refresh_tick(&s_planner, now, NULL);
+        max17048_sub_delivery_t deliveries[MAX17048_SUB_MAX];
+        int64_t next = INT64_MAX;
+        size_t count = 0;
+        if (err == ESP_OK)
+        {
+            count = max17048_sub_collect(now, deliveries, &next);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Refresh failed: %s", esp_err_to_name(err));
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (deliveries[i].cb != NULL)
+            {
+                deliveries[i].cb(&deliveries[i].update, deliveries[i].user_ctx);
+            }
+            else
+            {
+                xTaskNotify(deliveries[i].notify_task, deliveries[i].notify_bits, eSetBits);
+            }
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        s_stats.refresh = s_planner.stats;
+        s_stats.deliveries += count;
+        if (err != ESP_OK)
+        {
+            s_stats.read_errors++;
+        }
+        portEXIT_CRITICAL(&s_lock);
+
+        // Sleep until the next register or subscriber is due, waking early on (un)subscribe or stop
+        int64_t refresh_due = max17048_refresh_next_due(&s_planner);
+        if (refresh_due < next)
+        {
+            next = refresh_due;
+        }
+        TickType_t wait = portMAX_DELAY;
+        if (err != ESP_OK)
+        {
+            wait = pdMS_TO_TICKS(1000);
+        }
+        else if (next != INT64_MAX)
+        {
+            int64_t delay_ms = (next - esp_timer_get_time() + 999) / 1000;
+            wait = delay_ms > 0 ? pdMS_TO_TICKS((uint32_t)delay_ms) : 0;
+        }
+        if (wait > 0)
+        {
+            ulTaskNotifyTake(pdTRUE, wait);
+        }
+    }
+
+    xSemaphoreGive(s_stopped);
+    vTaskDelete(NULL);
+}
+
+static void max17048_sub_wake(void)
+{
+    TaskHandle_t task = s_task;
+    if (task != NULL)
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+// --- Public API Functions ---
+
+void max17048_sub_get_default_config(max17048_sub_service_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->task_stack_size = 3072;
+    config->task_priority = 5;
+}
+
+esp_err_t max17048_sub_start(const max17048_sub_service_config_t *config)
+{
+    if (config == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task != NULL)
+    {
+        ESP_LOGW(TAG, "Subscription service already running.");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    static const uint32_t none[MAX17048_REFRESH_REG_MAX] = { 0 };
+    max17048_refresh_init(&s_planner, none);
+    portENTER_CRITICAL(&s_lock);
+    s_dirty = true;
+    memset(&s_stats, 0, sizeof(s_stats));
+    portEXIT_CRITICAL(&s_lock);
+
+    s_stopping = false;
+    if (s_stopped == NULL)
+    {
+        s_stopped = xSemaphoreCreateBinaryStatic(&s_stopped_buf);
+    }
+    if (xTaskCreate(max17048_sub_task, "max17048_sub", config->task_stack_size, NULL, config->task_priority,
+                    &s_task) != pdPASS)
+    {
+        s_task = NULL;
+        ESP_LOGE(TAG, "Failed to create subscription task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t max17048_sub_stop(void)
+{
+    if (s_task == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xTaskGetCurrentTaskHandle() == s_task)
+    {
+        // A subscriber callback cannot wait for its own task to exit
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Not the caller's notification value: a notify-mode subscriber gets its bits there
+    s_stopping = true;
+    xTaskNotifyGive(s_task);
+    xSemaphoreTake(s_stopped, portMAX_DELAY);
+    s_task = NULL;
+    return ESP_OK;
+}
+
+esp_err_t max17048_sub_subscribe(const max17048_sub_config_t *config, int *ret_id)
+{
+    if (config == NULL || ret_id == NULL || (config->cb == NULL && config->notify_task == NULL) ||
+        config->max_staleness_ms == 0 ||
+        (config->fields & (uint16_t)((1u << MAX17048_REFRESH_REG_MAX) - 1)) == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&s_lock);
+    for (int s = 0; s < MAX17048_SUB_MAX; s++)
+    {
+        if (!s_subs[s].used)
+        {
+            memset(&s_subs[s], 0, sizeof(s_subs[s]));
+            s_subs[s].used = true;
+            s_subs[s].config = *config;
+            s_subs[s].next_us = INT64_MIN;
+            s_dirty = true;
+            *ret_id = s;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret == ESP_OK)
+    {
+        max17048_sub_wake();
+    }
+    return ret;
+}
+
+esp_err_t max17048_sub_unsubscribe(int id)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_lock);
+    if (id >= 0 && id < MAX17048_SUB_MAX && s_subs[id].used)
+    {
+        s_subs[id].used = false;
+        s_dirty = true;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (ret == ESP_OK)
+    {
+        max17048_sub_wake();
+    }
+    return ret;
+}
+
+esp_err_t max17048_sub_get_update(int id, max17048_sub_update_t *update)
+{
+    if (update == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_lock);
+    if (id >= 0 && id < MAX17048_SUB_MAX && s_subs[id].used && s_subs[id].has_last)
+    {
+        *update = s_subs[id].latest;
+        s_subs[id].pending = false;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+esp_err_t max17048_sub_get_counters(int id, max17048_sub_counters_t *counters)
+{
+    if (counters == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&s_lock);
+    if (id >= 0 && id < MAX17048_SUB_MAX && s_subs[id].used)
+    {
+        *counters = s_subs[id].counters;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+void max17048_sub_get_schedule(uint32_t interval_ms[MAX17048_REFRESH_REG_MAX])
+{
+    if (interval_ms == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    max17048_sub_merge(interval_ms);
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void max17048_sub_get_stats(max17048_sub_stats_t *stats)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    portEXIT_CRITICAL(&s_lock);
+}
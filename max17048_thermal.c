@@ -0,0 +1,307 @@
+#include "max17048_thermal.h"
+#include "max17048_sampler.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "soc/soc_caps.h"
+#if SOC_TEMP_SENSOR_SUPPORTED
+#include "driver/temperature_sensor.h"
+#endif
+
+static const char *TAG = "MAX17048_THERMAL";
+
+// Datasheet defaults for the stock model: RCOMP0 0x97, TempCoUp -0.5, TempCoDown -5.0
+static const max17048_model_t s_stock_model = {
+    .name = "stock",
+    .rcomp0 = 0x97,
+    .temp_co_up_q8 = -128,
+    .temp_co_down_q8 = -1280,
+};
+
+// Global variables
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static max17048_thermal_config_t s_config;
+static bool s_running = false;
+static bool s_has_temp = false;
+static int32_t s_temp_uc;                     // Estimated cell temperature, micro-degrees C
+static int64_t s_last_us;
+static volatile int32_t s_ambient_dc;         // Fixed ambient, or the offset added to the chip sensor
+static int32_t s_chip_dc;                     // Last chip sensor reading, taken by the task
+static int s_rcomp = -1;                      // Last RCOMP written, -1 if none
+static int s_pending_rcomp = -1;              // RCOMP for the task to write, -1 if none
+static TaskHandle_t s_task = NULL;
+static StaticSemaphore_t s_stopped_buf;
+static SemaphoreHandle_t s_stopped = NULL;
+static volatile bool s_stopping = false;
+#if SOC_TEMP_SENSOR_SUPPORTED
+static temperature_sensor_handle_t s_tsens = NULL;
+#endif
+
+// --- Internal Helper Functions ---
+
+static void max17048_thermal_read_chip(void)
+{
+#if SOC_TEMP_SENSOR_SUPPORTED
+    float celsius;
+    if (s_tsens != NULL && temperature_sensor_get_celsius(s_tsens, &celsius) == ESP_OK)
+    {
+        portENTER_CRITICAL(&s_lock);
+        s_chip_dc = (int32_t)(celsius * 10.0f);
+        portEXIT_CRITICAL(&s_lock);
+    }
+#endif
+}
+
+static void max17048_thermal_on_snapshot(const max17048_snapshot_t *snapshot, void *user_ctx)
+{
+    // CRATE 0.208 %/hr of capacity -> mA; self-heating P = I^2 * R, rise = P * theta
+    int64_t current_ma = (int64_t)snapshot->crate * 208 * s_config.capacity_mah / 100000;
+    int64_t power_uw = current_ma * current_ma * s_config.resistance_mohm / 1000;
+    int64_t rise_uc = power_uw * s_config.theta_dc_per_w / 10;
+
+    portENTER_CRITICAL(&s_lock);
+    int32_t ambient_dc = s_ambient_dc;
+    if (s_config.ambient == MAX17048_THERMAL_AMBIENT_CHIP)
+    {
+        // The die runs warmer than the cell's surroundings; the offset corrects for it
+        ambient_dc += s_chip_dc;
+    }
+    int32_t ambient_uc = ambient_dc * 100000;
+    int32_t target_uc = ambient_uc + (int32_t)rise_uc;
+    if (!s_has_temp)
+    {
+        s_temp_uc = ambient_uc;
+        s_has_temp = true;
+    }
+    else
+    {
+        // First-order lag, exact enough while dt is small against tau
+        int64_t tau_ms = (int64_t)s_config.tau_s * 1000;
+        int64_t dt_ms = (snapshot->timestamp_us - s_last_us) / 1000;
+        if (dt_ms > tau_ms)
+        {
+            dt_ms = tau_ms;
+        }
+        if (dt_ms > 0)
+        {
+            s_temp_uc += (int32_t)((int64_t)(target_uc - s_temp_uc) * dt_ms / tau_ms);
+        }
+    }
+    s_last_us = snapshot->timestamp_us;
+    int32_t temp_dc = s_temp_uc / 100000;
+
+    const max17048_model_t *model = s_config.model != NULL ? s_config.model : &s_stock_model;
+    int rcomp = max17048_model_rcomp(model, temp_dc);
+    bool wake = s_config.ambient == MAX17048_THERMAL_AMBIENT_CHIP;
+    if (s_rcomp < 0 || rcomp > s_rcomp + s_config.rcomp_deadband || rcomp < s_rcomp - s_config.rcomp_deadband)
+    {
+        s_pending_rcomp = rcomp;
+        wake = true;
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    // The I2C write and the sensor read happen on the thermal task, not the sampler's
+    if (wake)
+    {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+static void max17048_thermal_task(void *arg)
+{
+    while (!s_stopping)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (s_stopping)
+        {
+            break;
+        }
+
+        if (s_config.ambient == MAX17048_THERMAL_AMBIENT_CHIP)
+        {
+            // Used from the next snapshot on
+            max17048_thermal_read_chip();
+        }
+
+        portENTER_CRITICAL(&s_lock);
+        int rcomp = s_pending_rcomp;
+        s_pending_rcomp = -1;
+        int32_t temp_dc = s_temp_uc / 100000;
+        portEXIT_CRITICAL(&s_lock);
+        if (rcomp < 0)
+        {
+            continue;
+        }
+
+        esp_err_t err = max17048_set_rcomp((uint8_t)rcomp);
+        if (err == ESP_OK)
+        {
+            ESP_LOGD(TAG, "Cell %ld (0.1 C), RCOMP 0x%02x", (long)temp_dc, rcomp);
+            portENTER_CRITICAL(&s_lock);
+            s_rcomp = rcomp;
+            portEXIT_CRITICAL(&s_lock);
+        }
+        else
+        {
+            // The next snapshot asks again
+            ESP_LOGW(TAG, "RCOMP update failed: %s", esp_err_to_name(err));
+        }
+    }
+
+    xSemaphoreGive(s_stopped);
+    vTaskDelete(NULL);
+}
+
+static void max17048_thermal_release_sensor(void)
+{
+#if SOC_TEMP_SENSOR_SUPPORTED
+    if (s_tsens != NULL)
+    {
+        temperature_sensor_disable(s_tsens);
+        temperature_sensor_uninstall(s_tsens);
+        s_tsens = NULL;
+    }
+#endif
+}
+
+// --- Public API Functions ---
+
+void max17048_thermal_get_default_config(max17048_thermal_config_t *config)
+{
+    if (config == NULL)
+    {
+        return;
+    }
+
+    config->capacity_mah = 0;       // Must be set by caller
+    config->resistance_mohm = 150;
+    config->theta_dc_per_w = 300;   // 30 C/W, small pouch cell in an enclosure
+    config->tau_s = 600;
+    config->ambient = MAX17048_THERMAL_AMBIENT_FIXED;
+    config->ambient_dc = 200;
+    config->chip_offset_dc = 0;
+    config->model = NULL;
+    config->rcomp_deadband = 0;
+    config->task_stack_size = 2560;
+    config->task_priority = 4;
+}
+
+esp_err_t max17048_thermal_start(const max17048_thermal_config_t *config)
+{
+    if (config == NULL || config->capacity_mah == 0 || config->tau_s == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (config->ambient == MAX17048_THERMAL_AMBIENT_CHIP)
+    {
+#if SOC_TEMP_SENSOR_SUPPORTED
+        temperature_sensor_config_t tsens_config = { .range_min = -10, .range_max = 80 };
+        esp_err_t err = temperature_sensor_install(&tsens_config, &s_tsens);
+        if (err == ESP_OK)
+        {
+            err = temperature_sensor_enable(s_tsens);
+            if (err != ESP_OK)
+            {
+                temperature_sensor_uninstall(s_tsens);
+            }
+        }
+        if (err != ESP_OK)
+        {
+            s_tsens = NULL;
+            ESP_LOGE(TAG, "Temperature sensor setup failed: %s", esp_err_to_name(err));
+            return err;
+        }
+#else
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+    }
+
+    s_config = *config;
+    s_ambient_dc = config->ambient == MAX17048_THERMAL_AMBIENT_CHIP ? config->chip_offset_dc : config->ambient_dc;
+    s_chip_dc = 0;
+    s_has_temp = false;
+    s_rcomp = -1;
+    s_pending_rcomp = -1;
+    s_stopping = false;
+    if (config->ambient == MAX17048_THERMAL_AMBIENT_CHIP)
+    {
+        // Seed the reading the first snapshot starts from
+        max17048_thermal_read_chip();
+    }
+    if (s_stopped == NULL)
+    {
+        s_stopped = xSemaphoreCreateBinaryStatic(&s_stopped_buf);
+    }
+
+    if (xTaskCreate(max17048_thermal_task, "max17048_thermal", config->task_stack_size, NULL,
+                    config->task_priority, &s_task) != pdPASS)
+    {
+        s_task = NULL;
+        max17048_thermal_release_sensor();
+        ESP_LOGE(TAG, "Failed to create thermal task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = max17048_sampler_add_listener(max17048_thermal_on_snapshot, NULL);
+    if (err != ESP_OK)
+    {
+        s_stopping = true;
+        xTaskNotifyGive(s_task);
+        xSemaphoreTake(s_stopped, portMAX_DELAY);
+        s_task = NULL;
+        max17048_thermal_release_sensor();
+        return err;
+    }
+    s_running = true;
+    return ESP_OK;
+}
+
+esp_err_t max17048_thermal_stop(void)
+{
+    if (!s_running)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Waits for a snapshot callback in progress, which may still notify the task
+    esp_err_t err = max17048_sampler_remove_listener(max17048_thermal_on_snapshot, NULL);
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        return err;
+    }
+
+    s_stopping = true;
+    xTaskNotifyGive(s_task);
+    xSemaphoreTake(s_stopped, portMAX_DELAY);
+    s_task = NULL;
+    max17048_thermal_release_sensor();
+    s_running = false;
+    return ESP_OK;
+}
+
+void max17048_thermal_set_ambient(int32_t ambient_dc)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_ambient_dc = ambient_dc;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+esp_err_t max17048_thermal_get_temp(int32_t *temp_dc)
+{
+    if (temp_dc == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    bool has_temp = s_has_temp;
+    *temp_dc = s_temp_uc / 100000;
+    portEXIT_CRITICAL(&s_lock);
+    return has_temp ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,209 @@
+#include <string.h>
+#include "max17048_txn.h"
+#include "max17048_priv.h"
+#include "esp_idf_version.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Custom command lists in the i2c_master driver
+#define MAX17048_TXN_DEFINED_OPS (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 5, 0))
+
+#if MAX17048_TXN_DEFINED_OPS
+#define MAX17048_TXN_MAX_OPS_PER_STEP 7       // START, W, START, R, READ, READ(NACK), STOP
+#else
+static portMUX_TYPE s_init_lock = portMUX_INITIALIZER_UNLOCKED;
+static StaticSemaphore_t s_group_lock_buf;
+static SemaphoreHandle_t s_group_lock = NULL;
+#endif
+
+// --- Internal Helper Functions ---
+
+static max17048_txn_step_t *max17048_txn_next(max17048_txn_t *txn, i2c_master_dev_handle_t dev, uint8_t address)
+{
+    if (txn->count >= MAX17048_TXN_MAX_STEPS)
+    {
+        return NULL;
+    }
+    max17048_txn_step_t *step = &txn->steps[txn->count];
+    memset(step, 0, sizeof(*step));
+    step->dev = dev;
+    step->tx[0] = (uint8_t)(address << 1);
+    step->rx_addr = (uint8_t)((address << 1) | 1);
+    return step;
+}
+
+#if MAX17048_TXN_DEFINED_OPS
+static esp_err_t max17048_txn_run(max17048_txn_t *txn, uint32_t timeout_ms)
+{
+    i2c_operation_job_t ops[MAX17048_TXN_MAX_STEPS * MAX17048_TXN_MAX_OPS_PER_STEP];
+    size_t n = 0;
+
+    for (size_t i = 0; i < txn->count; i++)
+    {
+        max17048_txn_step_t *step = &txn->steps[i];
+        ops[n++] = (i2c_operation_job_t){ .command = I2C_MASTER_CMD_START };
+        ops[n++] = (i2c_operation_job_t){
+            .command = I2C_MASTER_CMD_WRITE,
+            .write = { .ack_check = true, .data = step->tx, .total_bytes = step->tx_len },
+        };
+        if (step->kind == MAX17048_TXN_READ)
+        {
+            ops[n++] = (i2c_operation_job_t){ .command = I2C_MASTER_CMD_START };
+            ops[n++] = (i2c_operation_job_t){
+                .command = I2C_MASTER_CMD_WRITE,
+                .write = { .ack_check = true, .data = &step->rx_addr, .total_bytes = 1 },
+            };
+            if (step->rx_len > 1)
+            {
+                ops[n++] = (i2c_operation_job_t){
+                    .command = I2C_MASTER_CMD_READ,
+                    .read = { .ack_value = I2C_ACK_VAL, .data = step->rx, .total_bytes = step->rx_len - 1 },
+                };
+            }
+            // The last byte is NACKed to end the read
+            ops[n++] = (i2c_operation_job_t){
+                .command = I2C_MASTER_CMD_READ,
+                .read = { .ack_value = I2C_NACK_VAL, .data = step->rx + step->rx_len - 1, .total_bytes = 1 },
+            };
+        }
+        ops[n++] = (i2c_operation_job_t){ .command = I2C_MASTER_CMD_STOP };
+    }
+
+    // The device handle only selects the bus and clock; addresses are in the command list
+    return i2c_master_execute_defined_operations(txn->steps[0].dev, ops, n, (int)timeout_ms);
+}
+#else
+static esp_err_t max17048_txn_run(max17048_txn_t *txn, uint32_t timeout_ms)
+{
+    // timeout_ms covers the whole group: the lock wait and every step share one deadline
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+
+    portENTER_CRITICAL(&s_init_lock);
+    if (s_group_lock == NULL)
+    {
+        s_group_lock = xSemaphoreCreateMutexStatic(&s_group_lock_buf);
+    }
+    portEXIT_CRITICAL(&s_init_lock);
+
+    if (xSemaphoreTake(s_group_lock, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < txn->count && ret == ESP_OK; i++)
+    {
+        int64_t left_us = deadline_us - esp_timer_get_time();
+        if (left_us <= 0)
+        {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        int left_ms = (int)((left_us + 999) / 1000);
+
+        max17048_txn_step_t *step = &txn->steps[i];
+        if (step->kind == MAX17048_TXN_READ)
+        {
+            ret = i2c_master_transmit_receive(step->dev, &step->tx[1], 1, step->rx, step->rx_len, left_ms);
+        }
+        else
+        {
+            ret = i2c_master_transmit(step->dev, &step->tx[1], step->tx_len - 1, left_ms);
+        }
+    }
+
+    xSemaphoreGive(s_group_lock);
+    return ret;
+}
+#endif
+
+// --- Public API Functions ---
+
+void max17048_txn_init(max17048_txn_t *txn)
+{
+    if (txn != NULL)
+    {
+        txn->count = 0;
+    }
+}
+
+esp_err_t max17048_txn_add_write(max17048_txn_t *txn, i2c_master_dev_handle_t dev, uint8_t address, const uint8_t *data,
+                                 size_t len)
+{
+    if (txn == NULL || dev == NULL || data == NULL || len == 0 || len > MAX17048_TXN_MAX_WRITE || address > 0x7F)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    max17048_txn_step_t *step = max17048_txn_next(txn, dev, address);
+    if (step == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    step->kind = MAX17048_TXN_WRITE;
+    memcpy(&step->tx[1], data, len);
+    step->tx_len = (uint8_t)(len + 1);
+    txn->count++;
+    return ESP_OK;
+}
+
+esp_err_t max17048_txn_add_read(max17048_txn_t *txn, i2c_master_dev_handle_t dev, uint8_t address, uint8_t reg,
+                                uint8_t *rx, size_t len)
+{
+    if (txn == NULL || dev == NULL || rx == NULL || len == 0 || len > UINT8_MAX || address > 0x7F)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    max17048_txn_step_t *step = max17048_txn_next(txn, dev, address);
+    if (step == NULL)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    step->kind = MAX17048_TXN_READ;
+    step->tx[1] = reg;
+    step->tx_len = 2;
+    step->rx = rx;
+    step->rx_len = (uint8_t)len;
+    txn->count++;
+    return ESP_OK;
+}
+
+esp_err_t max17048_txn_add_gauge_read(max17048_txn_t *txn, uint8_t reg, uint8_t *rx, size_t len)
+{
+    i2c_master_dev_handle_t dev;
+    uint8_t address;
+    esp_err_t ret = max17048_get_device(&dev, &address);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    return max17048_txn_add_read(txn, dev, address, reg, rx, len);
+}
+
+esp_err_t max17048_txn_add_gauge_write_word(max17048_txn_t *txn, uint8_t reg, uint16_t value)
+{
+    i2c_master_dev_handle_t dev;
+    uint8_t address;
+    esp_err_t ret = max17048_get_device(&dev, &address);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+    uint8_t data[3] = { reg, (uint8_t)(value >> 8), (uint8_t)(value & 0xFF) };
+    return max17048_txn_add_write(txn, dev, address, data, sizeof(data));
+}
+
+esp_err_t max17048_txn_execute(max17048_txn_t *txn, uint32_t timeout_ms)
+{
+    if (txn == NULL || txn->count == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t ret = max17048_txn_run(txn, timeout_ms);
+    max17048_stats_record(ret, start_us);
+    return ret;
+}
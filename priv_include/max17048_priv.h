@@ -0,0 +1,69 @@
+#ifndef MAX17048_PRIV_H
+#define MAX17048_PRIV_H
+
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+#include "max17048.h"
+#include "max17048_regs.h"
+
+/**
+ * @brief Burst-read consecutive registers from a gauge device.
+ *
+ * Shared by the single-gauge API and the pack sweep so that both issue
+ * identical bus traffic.
+ */
+esp_err_t max17048_i2c_read_regs(i2c_master_dev_handle_t dev, uint8_t reg_addr, uint8_t *data, size_t len, uint32_t timeout_ms);
+
+/**
+ * @brief Fill a snapshot from a gauge device.
+ *
+ * VCELL and SOC are read in one burst; CRATE costs a second transaction and
+ * is only read when requested (crate is left at 0 otherwise).
+ */
+esp_err_t max17048_i2c_read_snapshot(i2c_master_dev_handle_t dev, uint32_t timeout_ms, bool read_crate, max17048_snapshot_t *snapshot);
+
+/**
+ * @brief Read one 16-bit register of the initialized gauge.
+ */
+esp_err_t max17048_read_register(uint8_t reg_addr, uint16_t *value);
+
+/**
+ * @brief Write one 16-bit register of the initialized gauge.
+ */
+esp_err_t max17048_write_register(uint8_t reg_addr, uint16_t value);
+
+/**
+ * @brief Burst-read consecutive registers of the initialized gauge.
+ */
+esp_err_t max17048_read_burst(uint8_t reg_addr, uint8_t *data, size_t len);
+
+/**
+ * @brief Longest max17048_write_burst(), matching the 16-byte bursts of the model upload.
+ */
+#define MAX17048_WRITE_BURST_MAX 16
+
+/**
+ * @brief Burst-write consecutive registers of the initialized gauge (up to MAX17048_WRITE_BURST_MAX bytes).
+ */
+esp_err_t max17048_write_burst(uint8_t reg_addr, const uint8_t *data, size_t len);
+
+/**
+ * @brief Device handle and 7-bit address of the initialized gauge.
+ *
+ * @return ESP_ERR_INVALID_STATE if the driver is not initialized.
+ */
+esp_err_t max17048_get_device(i2c_master_dev_handle_t *dev, uint8_t *address);
+
+/**
+ * @brief Account one bus operation started at start_us in the driver statistics.
+ */
+void max17048_stats_record(esp_err_t ret, int64_t start_us);
+
+/**
+ * @brief Count a cached read that was served from the latest snapshot (hit) or found no data yet (miss).
+ *
+ * Reads that go to the bus on their own are not cache accesses and are not counted here.
+ */
+void max17048_stats_cache_access(bool hit);
+
+#endif // MAX17048_PRIV_H
@@ -0,0 +1,186 @@
+/*
+ * Exhaustive conversion check and micro-benchmark.
+ *
+ * Every raw VCELL, SOC and CRATE value (65,536 each) is converted through
+ * the float helpers behind max17048_get_voltage/soc/crate and the integer
+ * helpers, all in max17048_regs.h. Each result is compared against the
+ * exact rational value computed in integers:
+ *
+ *     VCELL  raw * 625/8 uV        int: floor, float: within VCELL_FLOAT_BOUND_UV
+ *     SOC    raw * 125/32 m%       int: floor, float: bit-exact (1/256 is a power of two)
+ *     CRATE  raw * 208 m%/hr       int: exact, float: within CRATE_FLOAT_BOUND_REL
+ *
+ * then each path is timed over all raw values. Exits non-zero on any
+ * violation, so it can gate a port to a new target or compiler.
+ *
+ * Build:
+ *     cc -O2 -Wall -I../../include -o max17048_conv_bench max17048_conv_bench.c -lm
+ *
+ * Usage:
+ *     max17048_conv_bench [rounds]
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "max17048_regs.h"
+
+#define RAW_VALUES 65536
+#define VCELL_FLOAT_BOUND_UV 0.5              // One float ulp at 5.12 V is 0.48 uV
+#define CRATE_FLOAT_BOUND_REL 1.2e-7          // Constant rounding plus product rounding
+
+// Every path stores each result here, so none can be optimised away or accumulated more cheaply
+static volatile float s_sink_f;
+static volatile uint32_t s_sink_u;
+static volatile int32_t s_sink_i;
+
+// --- Float paths: the driver's getter expressions ---
+
+static float vcell_float(uint16_t raw)
+{
+    return max17048_regs_vcell_v(raw, MAX17048_VARIANT_MAX17048);
+}
+
+static float soc_float(uint16_t raw)
+{
+    return max17048_regs_soc_pct(raw);
+}
+
+// Single-multiply alternative to the getter's split form
+static float soc_float_mul(uint16_t raw)
+{
+    return raw * MAX17048_SOC_LSB_PCT;
+}
+
+static float crate_float(uint16_t raw)
+{
+    return max17048_regs_crate_pct_hr((int16_t)raw);
+}
+
+// --- Verification ---
+
+static int verify(void)
+{
+    int failures = 0;
+    double vcell_max_err = 0.0, crate_max_rel = 0.0;
+
+    for (uint32_t i = 0; i < RAW_VALUES; i++)
+    {
+        uint16_t raw = (uint16_t)i;
+
+        // VCELL: integer floor of raw * 625 / 8, float close to the exact value
+        uint64_t num = (uint64_t)raw * 625;
+        uint32_t uv = max17048_regs_vcell_uv(raw);
+        if ((uint64_t)uv * 8 > num || (uint64_t)uv * 8 + 8 <= num)
+        {
+            printf("VCELL int mismatch raw=%u: %u uV\n", raw, uv);
+            failures++;
+        }
+        if (max17048_regs_vcell_stack_uv(raw, MAX17048_VARIANT_MAX17048) != uv ||
+            max17048_regs_vcell_stack_uv(raw, MAX17048_VARIANT_MAX17049) != (uint32_t)(num >> 2))
+        {
+            printf("VCELL stack mismatch raw=%u\n", raw);
+            failures++;
+        }
+        double vcell_err = fabs((double)vcell_float(raw) * 1e6 - (double)num / 8.0);
+        vcell_max_err = vcell_err > vcell_max_err ? vcell_err : vcell_max_err;
+        if (vcell_err > VCELL_FLOAT_BOUND_UV)
+        {
+            printf("VCELL float error raw=%u: %.3f uV\n", raw, vcell_err);
+            failures++;
+        }
+
+        // SOC: integer floor of raw * 125 / 32, both float forms exact
+        num = (uint64_t)raw * 125;
+        uint32_t mpct = max17048_regs_soc_mpct(raw);
+        if ((uint64_t)mpct * 32 > num || (uint64_t)mpct * 32 + 32 <= num)
+        {
+            printf("SOC int mismatch raw=%u: %u m%%\n", raw, mpct);
+            failures++;
+        }
+        if ((double)soc_float(raw) != raw / 256.0 || soc_float_mul(raw) != soc_float(raw))
+        {
+            printf("SOC float not exact raw=%u\n", raw);
+            failures++;
+        }
+
+        // CRATE: integer exact, float within relative bound
+        int32_t exact = (int16_t)raw * 208;
+        if (max17048_regs_crate_mpct_hr((int16_t)raw) != exact)
+        {
+            printf("CRATE int mismatch raw=%d\n", (int16_t)raw);
+            failures++;
+        }
+        if (exact != 0)
+        {
+            double rel = fabs((double)crate_float(raw) * 1000.0 - exact) / fabs((double)exact);
+            crate_max_rel = rel > crate_max_rel ? rel : crate_max_rel;
+            if (rel > CRATE_FLOAT_BOUND_REL)
+            {
+                printf("CRATE float error raw=%d: %.3g relative\n", (int16_t)raw, rel);
+                failures++;
+            }
+        }
+        else if (crate_float(raw) != 0.0f)
+        {
+            failures++;
+        }
+    }
+
+    printf("verified %d raw values per field: VCELL float max error %.3f uV, CRATE float max relative error %.3g, "
+           "%d failures\n", RAW_VALUES, vcell_max_err, crate_max_rel, failures);
+    return failures;
+}
+
+// --- Benchmark ---
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#define BENCH(name, sink, expr)                                              \
+    do                                                                       \
+    {                                                                        \
+        double start = now_ns();                                             \
+        for (int r = 0; r < rounds; r++)                                     \
+        {                                                                    \
+            for (uint32_t i = 0; i < RAW_VALUES; i++)                        \
+            {                                                                \
+                uint16_t raw = (uint16_t)(i ^ (uint32_t)r);                  \
+                (sink) = (expr);                                             \
+            }                                                                \
+        }                                                                    \
+        double ns = (now_ns() - start) / ((double)rounds * RAW_VALUES);      \
+        printf("%-28s %6.3f ns/conversion\n", name, ns);                    \
+    } while (0)
+
+static void bench(int rounds)
+{
+    BENCH("vcell float", s_sink_f, vcell_float(raw));
+    BENCH("vcell int uV", s_sink_u, max17048_regs_vcell_uv(raw));
+    BENCH("soc float (split)", s_sink_f, soc_float(raw));
+    BENCH("soc float (mul)", s_sink_f, soc_float_mul(raw));
+    BENCH("soc int m%", s_sink_u, max17048_regs_soc_mpct(raw));
+    BENCH("crate float", s_sink_f, crate_float(raw));
+    BENCH("crate int m%/hr", s_sink_i, max17048_regs_crate_mpct_hr((int16_t)raw));
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    if (rounds <= 0)
+    {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    int failures = verify();
+    bench(rounds);
+    return failures == 0 ? 0 : 1;
+}
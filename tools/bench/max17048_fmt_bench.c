@@ -0,0 +1,214 @@
+/*
+ * Fixed-point formatter check and benchmark against snprintf.
+ *
+ * Every raw VCELL, SOC and CRATE value is formatted with max17048_fmt_*()
+ * for 0 to 4 decimals and compared with snprintf("%.*f") of the exact value
+ * in double. They must match except on exact decimal ties, where snprintf
+ * sees the nearest binary double and the formatter rounds away from zero.
+ * The float the driver's getters return is printed the same way and its
+ * disagreements with the exact rendering are reported for information.
+ * Then the formatter is timed against snprintf of the float.
+ *
+ * Flash cost is a target property: compare `idf.py size-components` of an
+ * application printing readings with "%.2f" against one using
+ * max17048_fmt_*() with CONFIG_NEWLIB_NANO_FORMAT, which drops float printf.
+ *
+ * Build:
+ *     cc -O2 -Wall -I../../include -o max17048_fmt_bench max17048_fmt_bench.c ../../max17048_fmt.c
+ *
+ * Usage:
+ *     max17048_fmt_bench [rounds]
+ */
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "max17048_fmt.h"
+
+#define RAW_VALUES 65536
+#define MAX_DECIMALS 4
+
+typedef enum { FIELD_VCELL, FIELD_SOC, FIELD_CRATE, FIELD_COUNT } field_t;
+
+static const char *const s_names[FIELD_COUNT] = { "vcell", "soc", "crate" };
+static volatile size_t s_sink;
+
+// Float value as returned by max17048_get_voltage/soc/crate()
+static float field_float(field_t field, uint16_t raw)
+{
+    switch (field)
+    {
+    case FIELD_VCELL:
+        return max17048_regs_vcell_v(raw, MAX17048_VARIANT_MAX17048);
+    case FIELD_SOC:
+        return max17048_regs_soc_pct(raw);
+    default:
+        return max17048_regs_crate_pct_hr((int16_t)raw);
+    }
+}
+
+static size_t field_fmt(field_t field, char *buf, size_t size, uint16_t raw, uint8_t decimals)
+{
+    switch (field)
+    {
+    case FIELD_VCELL:
+        return max17048_fmt_vcell(buf, size, raw, decimals);
+    case FIELD_SOC:
+        return max17048_fmt_soc(buf, size, raw, decimals);
+    default:
+        return max17048_fmt_crate(buf, size, (int16_t)raw, decimals);
+    }
+}
+
+// Exact value in units of 10^-exact_decimals[field]
+static const uint8_t s_exact_decimals[FIELD_COUNT] = { 9, 8, 3 };
+
+static int64_t field_exact(field_t field, uint16_t raw)
+{
+    switch (field)
+    {
+    case FIELD_VCELL:
+        return (int64_t)raw * 78125;
+    case FIELD_SOC:
+        return (int64_t)raw * 390625;
+    default:
+        return (int64_t)(int16_t)raw * 208;
+    }
+}
+
+static double field_double(field_t field, uint16_t raw)
+{
+    static const double scale[FIELD_COUNT] = { 1e9, 1e8, 1e3 };
+    return (double)field_exact(field, raw) / scale[field];
+}
+
+static int is_tie(field_t field, uint16_t raw, uint8_t decimals)
+{
+    if (decimals >= s_exact_decimals[field])
+    {
+        return 0;
+    }
+    int64_t div = 1;
+    for (int i = decimals; i < s_exact_decimals[field]; i++)
+    {
+        div *= 10;
+    }
+    int64_t v = field_exact(field, raw);
+    return (v < 0 ? -v : v) % div == div / 2;
+}
+
+// Both strings as integers in units of the last digit (same decimals, so the points line up)
+static long long digits_value(const char *s)
+{
+    long long v = 0;
+    int negative = *s == '-';
+    for (; *s; s++)
+    {
+        if (*s >= '0' && *s <= '9')
+        {
+            v = v * 10 + (*s - '0');
+        }
+    }
+    return negative ? -v : v;
+}
+
+static int verify(void)
+{
+    int failures = 0;
+
+    for (int field = 0; field < FIELD_COUNT; field++)
+    {
+        unsigned ties = 0, float_wrong = 0;
+        for (uint8_t decimals = 0; decimals <= MAX_DECIMALS; decimals++)
+        {
+            for (uint32_t i = 0; i < RAW_VALUES; i++)
+            {
+                char ours[MAX17048_FMT_MAX_LEN], ref[64], flt[64];
+                size_t len = field_fmt(field, ours, sizeof(ours), (uint16_t)i, decimals);
+                snprintf(ref, sizeof(ref), "%.*f", decimals, field_double(field, (uint16_t)i));
+                snprintf(flt, sizeof(flt), "%.*f", decimals, (double)field_float(field, (uint16_t)i));
+                if (strcmp(flt, ref) != 0 && digits_value(flt) != digits_value(ref))
+                {
+                    float_wrong++;
+                }
+                if (len != strlen(ours))
+                {
+                    failures++;
+                }
+                if (strcmp(ours, ref) == 0 || (digits_value(ours) == 0 && digits_value(ref) == 0))
+                {
+                    // snprintf may print "-0.00"; the formatter drops the sign
+                    continue;
+                }
+                long long diff = digits_value(ours) - digits_value(ref);
+                if ((diff == 1 || diff == -1) && is_tie(field, (uint16_t)i, decimals))
+                {
+                    ties++;
+                    continue;
+                }
+                printf("%s raw=%u decimals=%u: \"%s\" vs exact \"%s\"\n", s_names[field], i, decimals, ours, ref);
+                failures++;
+            }
+        }
+        printf("%-5s %u values x %d precisions: ties rounded away from zero %u, float getter path wrong %u\n",
+               s_names[field], RAW_VALUES, MAX_DECIMALS + 1, ties, float_wrong);
+    }
+    return failures;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(int rounds)
+{
+    char buf[MAX17048_FMT_MAX_LEN];
+
+    for (int field = 0; field < FIELD_COUNT; field++)
+    {
+        size_t acc = 0;
+        double start = now_ns();
+        for (int r = 0; r < rounds; r++)
+        {
+            for (uint32_t i = 0; i < RAW_VALUES; i++)
+            {
+                acc += field_fmt(field, buf, sizeof(buf), (uint16_t)i, 2);
+            }
+        }
+        double fmt_ns = (now_ns() - start) / ((double)rounds * RAW_VALUES);
+
+        start = now_ns();
+        for (int r = 0; r < rounds; r++)
+        {
+            for (uint32_t i = 0; i < RAW_VALUES; i++)
+            {
+                acc += (size_t)snprintf(buf, sizeof(buf), "%.2f", (double)field_float(field, (uint16_t)i));
+            }
+        }
+        double printf_ns = (now_ns() - start) / ((double)rounds * RAW_VALUES);
+        s_sink = acc;
+        printf("%-5s max17048_fmt %7.1f ns, snprintf %7.1f ns (%.1fx)\n", s_names[field], fmt_ns, printf_ns,
+               printf_ns / fmt_ns);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 20;
+    if (rounds <= 0)
+    {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    int failures = verify();
+    printf("%d failures\n", failures);
+    bench(rounds);
+    return failures == 0 ? 0 : 1;
+}
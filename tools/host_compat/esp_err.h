@@ -0,0 +1,28 @@
+#ifndef MAX17048_HOST_ESP_ERR_H
+#define MAX17048_HOST_ESP_ERR_H
+
+/*
+ * Minimal esp_err.h for building the platform-independent driver modules
+ * (max17048_frame.c, max17048_filter.c, ...) into host tools. Values match
+ * ESP-IDF so error codes read the same on both sides.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_INVALID_RESPONSE 0x108
+#define ESP_ERR_INVALID_CRC 0x109
+#define ESP_ERR_INVALID_VERSION 0x10A
+
+#endif // MAX17048_HOST_ESP_ERR_H
@@ -0,0 +1,609 @@
+/*
+ * Reference fleet telemetry ingest server.
+ *
+ * Receives max17048_frame datagrams over UDP on several worker threads
+ * (one SO_REUSEPORT socket each), decodes them with the driver's frame codec
+ * and folds every snapshot into per-device state kept in a lock-striped hash
+ * map: latest snapshot, SOC/VCELL rollups and a VCELL histogram sketch for
+ * quantiles. A fleet-wide sketch is kept per worker and merged on report.
+ *
+ * Build:
+ *     cc -O2 -Wall -pthread -I../../include -I../host_compat \
+ *        -o max17048_ingest max17048_ingest.c ../../max17048_frame.c
+ *
+ * Modes:
+ *     max17048_ingest serve   [-p port] [-t threads]
+ *     max17048_ingest loadgen [-h host] [-p port] [-t threads] [-d devices] [-r frames_per_s] [-s seconds]
+ *     max17048_ingest bench   [-t threads] [-d devices] [-f frames_per_thread]
+ *
+ * "serve" reports every 5 s and, on SIGINT or SIGTERM, joins its workers
+ * and prints a final report. "bench" runs the decode and ingest path
+ * in-process without sockets and reports frames per second per core.
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "max17048_frame.h"
+
+#define STRIPES 256                           // Lock stripes, power of two
+#define MAX_DATAGRAM 1500
+#define RECV_BATCH 32
+#define SAMPLES_PER_FRAME 16
+#define MIN_RECORD_SIZE 4                     // Timestamp and three field deltas, one varint byte each
+#define MAX_RECORDS ((MAX_DATAGRAM - MAX17048_FRAME_HEADER_SIZE - MAX17048_FRAME_TRAILER_SIZE) / MIN_RECORD_SIZE)
+#define SKETCH_SHIFT 8                        // VCELL sketch bucket = 256 LSB = 20 mV
+#define SKETCH_BUCKETS (65536 >> SKETCH_SHIFT)
+
+// Worker counters have a single writer; relaxed atomics let report() read them while it runs
+#define OWNED_ADD(p, n) __atomic_store_n((p), __atomic_load_n((p), __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+#define OWNED_READ(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+
+typedef struct {
+    uint32_t buckets[SKETCH_BUCKETS];
+    uint64_t count;
+} sketch_t;
+
+typedef struct device {
+    struct device *next;
+    uint64_t id;
+    uint64_t frames;
+    uint64_t samples;
+    max17048_snapshot_t last;
+    uint16_t soc_min, soc_max;
+    uint16_t vcell_min, vcell_max;
+    uint64_t soc_sum;
+    sketch_t vcell;
+} device_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    device_t **table;
+    size_t size;
+    size_t count;
+} stripe_t;
+
+typedef struct {
+    int id;
+    int fd;
+    uint64_t frames;
+    uint64_t bad_frames;
+    uint64_t dropped_frames;                  // Well-formed, but no memory for a new device
+    uint64_t samples;
+    sketch_t fleet_vcell;
+} worker_t;
+
+static stripe_t s_stripes[STRIPES];
+static int s_stop = 0;                        // Set from the signal handler, read by every thread
+
+// --- Device map ---
+
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+}
+
+static int map_init(void)
+{
+    for (int i = 0; i < STRIPES; i++)
+    {
+        pthread_mutex_init(&s_stripes[i].lock, NULL);
+        s_stripes[i].size = 64;
+        s_stripes[i].table = calloc(s_stripes[i].size, sizeof(device_t *));
+        if (s_stripes[i].table == NULL)
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Called with the stripe locked; NULL if a new device cannot be allocated
+static device_t *stripe_get(stripe_t *stripe, uint64_t id, uint64_t hash)
+{
+    size_t slot = (hash >> 8) & (stripe->size - 1);
+    for (device_t *d = stripe->table[slot]; d != NULL; d = d->next)
+    {
+        if (d->id == id)
+        {
+            return d;
+        }
+    }
+
+    // Without memory to grow, chains just get longer
+    device_t **table = stripe->count >= stripe->size ? calloc(stripe->size * 2, sizeof(device_t *)) : NULL;
+    if (table != NULL)
+    {
+        size_t size = stripe->size * 2;
+        for (size_t i = 0; i < stripe->size; i++)
+        {
+            for (device_t *d = stripe->table[i], *next; d != NULL; d = next)
+            {
+                next = d->next;
+                size_t s = (mix64(d->id) >> 8) & (size - 1);
+                d->next = table[s];
+                table[s] = d;
+            }
+        }
+        free(stripe->table);
+        stripe->table = table;
+        stripe->size = size;
+        slot = (hash >> 8) & (size - 1);
+    }
+
+    device_t *d = calloc(1, sizeof(*d));
+    if (d == NULL)
+    {
+        return NULL;
+    }
+    d->id = id;
+    d->soc_min = d->vcell_min = UINT16_MAX;
+    d->next = stripe->table[slot];
+    stripe->table[slot] = d;
+    stripe->count++;
+    return d;
+}
+
+static int ingest_frame(worker_t *w, const uint8_t *buf, size_t len)
+{
+    max17048_frame_decoder_t dec;
+    max17048_snapshot_t samples[MAX_RECORDS];
+    size_t n = 0;
+
+    // Decode outside the lock; only the fold into device state is serialised
+    if (len > MAX_DATAGRAM || max17048_frame_decode_begin(&dec, buf, len) != ESP_OK)
+    {
+        OWNED_ADD(&w->bad_frames, 1);
+        return -1;
+    }
+    // Every record fits: a datagram cannot hold more than MAX_RECORDS
+    esp_err_t err;
+    while ((err = max17048_frame_decode_next(&dec, &samples[n])) == ESP_OK)
+    {
+        n++;
+    }
+    if (err != ESP_ERR_NOT_FOUND)
+    {
+        // Records ended before the header's count, or a delta left the register range
+        OWNED_ADD(&w->bad_frames, 1);
+        return -1;
+    }
+    uint64_t hash = mix64(dec.device_id);
+    stripe_t *stripe = &s_stripes[hash & (STRIPES - 1)];
+    pthread_mutex_lock(&stripe->lock);
+    device_t *d = stripe_get(stripe, dec.device_id, hash);
+    if (d == NULL)
+    {
+        pthread_mutex_unlock(&stripe->lock);
+        OWNED_ADD(&w->dropped_frames, 1);
+        return -1;
+    }
+    d->frames++;
+    for (size_t i = 0; i < n; i++)
+    {
+        const max17048_snapshot_t *s = &samples[i];
+        d->soc_min = s->soc < d->soc_min ? s->soc : d->soc_min;
+        d->soc_max = s->soc > d->soc_max ? s->soc : d->soc_max;
+        d->vcell_min = s->vcell < d->vcell_min ? s->vcell : d->vcell_min;
+        d->vcell_max = s->vcell > d->vcell_max ? s->vcell : d->vcell_max;
+        d->soc_sum += s->soc;
+        d->vcell.buckets[s->vcell >> SKETCH_SHIFT]++;
+        if (s->timestamp_us >= d->last.timestamp_us)
+        {
+            d->last = *s;
+        }
+    }
+    d->samples += n;
+    d->vcell.count += n;
+    pthread_mutex_unlock(&stripe->lock);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        OWNED_ADD(&w->fleet_vcell.buckets[samples[i].vcell >> SKETCH_SHIFT], 1);
+    }
+    OWNED_ADD(&w->fleet_vcell.count, n);
+    OWNED_ADD(&w->frames, 1);
+    OWNED_ADD(&w->samples, n);
+    return 0;
+}
+
+static double sketch_quantile_v(const sketch_t *sk, double q)
+{
+    uint64_t rank = (uint64_t)(q * (double)(sk->count ? sk->count - 1 : 0));
+    uint64_t seen = 0;
+    for (int b = 0; b < SKETCH_BUCKETS; b++)
+    {
+        seen += sk->buckets[b];
+        if (seen > rank)
+        {
+            // Bucket midpoint in volts
+            return ((b << SKETCH_SHIFT) + (1 << (SKETCH_SHIFT - 1))) * 0.000078125;
+        }
+    }
+    return 0.0;
+}
+
+// --- Synthetic frames ---
+
+static size_t make_frame(uint8_t *buf, size_t size, uint64_t device, uint64_t seq)
+{
+    max17048_frame_encoder_t enc;
+    max17048_frame_begin(&enc, buf, size, device);
+    for (int i = 0; i < SAMPLES_PER_FRAME; i++)
+    {
+        uint64_t t = seq * SAMPLES_PER_FRAME + i;
+        max17048_snapshot_t s = {
+            .vcell = (uint16_t)(48000 + (device * 37 + t) % 4000),
+            .soc = (uint16_t)(25600 - (t % 25600)),
+            .crate = (int16_t)(-20 - (int)(device % 10)),
+            .timestamp_us = (int64_t)t * 1000000,
+        };
+        max17048_frame_add(&enc, &s);
+    }
+    size_t len;
+    max17048_frame_finish(&enc, &len);
+    return len;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double thread_cpu_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// --- Modes ---
+
+static int s_port = 7048;
+static int s_threads = 4;
+static uint64_t s_devices = 10000;
+static uint64_t s_frames = 200000;
+static double s_rate = 10000;
+static double s_seconds = 10;
+static const char *s_host = "127.0.0.1";
+
+static void *serve_worker(void *arg)
+{
+    worker_t *w = arg;
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iov[RECV_BATCH];
+    static __thread uint8_t bufs[RECV_BATCH][MAX_DATAGRAM];
+
+    for (int i = 0; i < RECV_BATCH; i++)
+    {
+        iov[i].iov_base = bufs[i];
+        iov[i].iov_len = MAX_DATAGRAM;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (!__atomic_load_n(&s_stop, __ATOMIC_RELAXED))
+    {
+        int n = recvmmsg(w->fd, msgs, RECV_BATCH, MSG_WAITFORONE, NULL);
+        for (int i = 0; i < n; i++)
+        {
+            ingest_frame(w, bufs[i], msgs[i].msg_len);
+        }
+    }
+    return NULL;
+}
+
+// Safe while workers run: their counters are read atomically and the device count under each stripe lock
+static void report(worker_t *workers, int count, double elapsed, double cpu)
+{
+    uint64_t frames = 0, bad = 0, dropped = 0, samples = 0, devices = 0;
+    sketch_t fleet = { 0 };
+    for (int t = 0; t < count; t++)
+    {
+        frames += OWNED_READ(&workers[t].frames);
+        bad += OWNED_READ(&workers[t].bad_frames);
+        dropped += OWNED_READ(&workers[t].dropped_frames);
+        samples += OWNED_READ(&workers[t].samples);
+        for (int b = 0; b < SKETCH_BUCKETS; b++)
+        {
+            fleet.buckets[b] += OWNED_READ(&workers[t].fleet_vcell.buckets[b]);
+        }
+        fleet.count += OWNED_READ(&workers[t].fleet_vcell.count);
+    }
+    for (int i = 0; i < STRIPES; i++)
+    {
+        pthread_mutex_lock(&s_stripes[i].lock);
+        devices += s_stripes[i].count;
+        pthread_mutex_unlock(&s_stripes[i].lock);
+    }
+
+    printf("devices %llu, frames %llu (%llu bad, %llu dropped), samples %llu\n", (unsigned long long)devices,
+           (unsigned long long)frames, (unsigned long long)bad, (unsigned long long)dropped,
+           (unsigned long long)samples);
+    printf("fleet VCELL p05 %.3f V, p50 %.3f V, p95 %.3f V\n", sketch_quantile_v(&fleet, 0.05),
+           sketch_quantile_v(&fleet, 0.5), sketch_quantile_v(&fleet, 0.95));
+    if (elapsed > 0 && cpu > 0)
+    {
+        printf("%.0f frames/s total, %.0f frames/s per core\n", frames / elapsed, frames / cpu);
+    }
+}
+
+static void on_stop_signal(int sig)
+{
+    (void)sig;
+    __atomic_store_n(&s_stop, 1, __ATOMIC_RELAXED);
+}
+
+static int run_serve(void)
+{
+    worker_t *workers = calloc(s_threads, sizeof(worker_t));
+    pthread_t *threads = calloc(s_threads, sizeof(pthread_t));
+    if (workers == NULL || threads == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // No SA_RESTART, so the report sleep returns as soon as a signal arrives
+    struct sigaction sa = { .sa_handler = on_stop_signal };
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int started = 0;
+    int ret = 0;
+    for (int t = 0; t < s_threads; t++)
+    {
+        int one = 1;
+        struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(s_port), .sin_addr.s_addr = INADDR_ANY };
+        workers[t].id = t;
+        workers[t].fd = socket(AF_INET, SOCK_DGRAM, 0);
+        setsockopt(workers[t].fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+        if (bind(workers[t].fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+        {
+            fprintf(stderr, "bind: %s\n", strerror(errno));
+            close(workers[t].fd);
+            ret = 1;
+            break;
+        }
+        struct timeval tv = { .tv_sec = 1 };
+        setsockopt(workers[t].fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        int err = pthread_create(&threads[t], NULL, serve_worker, &workers[t]);
+        if (err != 0)
+        {
+            // SO_REUSEPORT spreads datagrams over the sockets still open, so fewer workers still serve
+            fprintf(stderr, "warning: only %d of %d workers started: %s\n", started, s_threads, strerror(err));
+            close(workers[t].fd);
+            break;
+        }
+        started++;
+    }
+    if (started == 0)
+    {
+        ret = 1;
+    }
+
+    double start = now_s();
+    if (ret == 0)
+    {
+        setvbuf(stdout, NULL, _IOLBF, 0);
+        printf("listening on udp/%d with %d workers\n", s_port, started);
+        while (!__atomic_load_n(&s_stop, __ATOMIC_RELAXED))
+        {
+            sleep(5);
+            if (!__atomic_load_n(&s_stop, __ATOMIC_RELAXED))
+            {
+                report(workers, started, 0, 0);
+            }
+        }
+    }
+
+    // Workers notice s_stop within one receive timeout
+    __atomic_store_n(&s_stop, 1, __ATOMIC_RELAXED);
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(threads[t], NULL);
+        close(workers[t].fd);
+    }
+    if (ret == 0)
+    {
+        report(workers, started, now_s() - start, 0);
+    }
+    free(threads);
+    free(workers);
+    return ret;
+}
+
+static void *loadgen_worker(void *arg)
+{
+    worker_t *w = arg;
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(s_port) };
+    inet_pton(AF_INET, s_host, &addr.sin_addr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    uint8_t buf[MAX_DATAGRAM];
+
+    double per_thread = s_rate / s_threads;
+    double start = now_s();
+    uint64_t sent = 0;
+    while (now_s() - start < s_seconds)
+    {
+        uint64_t device = (w->id + sent * s_threads) % s_devices;
+        size_t len = make_frame(buf, sizeof(buf), device, sent);
+        sendto(fd, buf, len, 0, (struct sockaddr *)&addr, sizeof(addr));
+        sent++;
+        double ahead = sent / per_thread - (now_s() - start);
+        if (ahead > 0.001)
+        {
+            usleep((useconds_t)(ahead * 1e6));
+        }
+    }
+    w->frames = sent;
+    close(fd);
+    return NULL;
+}
+
+static int run_loadgen(void)
+{
+    worker_t *workers = calloc(s_threads, sizeof(worker_t));
+    pthread_t *threads = calloc(s_threads, sizeof(pthread_t));
+    if (workers == NULL || threads == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    int started = 0;
+    while (started < s_threads)
+    {
+        workers[started].id = started;
+        int err = pthread_create(&threads[started], NULL, loadgen_worker, &workers[started]);
+        if (err != 0)
+        {
+            // Each thread sends its share of the rate, so fewer threads send less
+            fprintf(stderr, "warning: only %d of %d threads started: %s\n", started, s_threads, strerror(err));
+            break;
+        }
+        started++;
+    }
+    uint64_t sent = 0;
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(threads[t], NULL);
+        sent += workers[t].frames;
+    }
+    printf("sent %llu frames in %.1f s\n", (unsigned long long)sent, s_seconds);
+    free(threads);
+    free(workers);
+    return started > 0 ? 0 : 1;
+}
+
+typedef struct {
+    worker_t worker;
+    double cpu_s;
+} bench_t;
+
+static void *bench_worker(void *arg)
+{
+    bench_t *b = arg;
+    enum { POOL = 1024 };
+    static __thread uint8_t pool[POOL][MAX_DATAGRAM];
+    static __thread size_t lens[POOL];
+
+    // Pre-encode so only decode and ingest are measured
+    for (int i = 0; i < POOL; i++)
+    {
+        uint64_t device = ((uint64_t)b->worker.id * POOL + i) % s_devices;
+        lens[i] = make_frame(pool[i], MAX_DATAGRAM, device, i);
+    }
+
+    double cpu = thread_cpu_s();
+    for (uint64_t f = 0; f < s_frames; f++)
+    {
+        ingest_frame(&b->worker, pool[f % POOL], lens[f % POOL]);
+    }
+    b->cpu_s = thread_cpu_s() - cpu;
+    return NULL;
+}
+
+static int run_bench(void)
+{
+    bench_t *benches = calloc(s_threads, sizeof(bench_t));
+    pthread_t *threads = calloc(s_threads, sizeof(pthread_t));
+    worker_t *workers = calloc(s_threads, sizeof(worker_t));
+    if (benches == NULL || threads == NULL || workers == NULL)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    double start = now_s();
+    int started = 0;
+    while (started < s_threads)
+    {
+        benches[started].worker.id = started;
+        int err = pthread_create(&threads[started], NULL, bench_worker, &benches[started]);
+        if (err != 0)
+        {
+            // Per-core throughput stays meaningful with fewer threads
+            fprintf(stderr, "warning: only %d of %d threads started: %s\n", started, s_threads, strerror(err));
+            break;
+        }
+        started++;
+    }
+
+    double cpu = 0;
+    for (int t = 0; t < started; t++)
+    {
+        pthread_join(threads[t], NULL);
+        cpu += benches[t].cpu_s;
+        workers[t] = benches[t].worker;
+    }
+    if (started > 0)
+    {
+        report(workers, started, now_s() - start, cpu);
+    }
+    free(workers);
+    free(threads);
+    free(benches);
+    return started > 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s serve|loadgen|bench [options]\n", argv[0]);
+        return 2;
+    }
+    const char *mode = argv[1];
+
+    int opt;
+    optind = 2;
+    while ((opt = getopt(argc, argv, "h:p:t:d:r:s:f:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'h': s_host = optarg; break;
+        case 'p': s_port = atoi(optarg); break;
+        case 't': s_threads = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'd': s_devices = strtoull(optarg, NULL, 0) ? strtoull(optarg, NULL, 0) : 1; break;
+        case 'r': s_rate = atof(optarg) > 0 ? atof(optarg) : 1; break;
+        case 's': s_seconds = atof(optarg); break;
+        case 'f': s_frames = strtoull(optarg, NULL, 0); break;
+        default: return 2;
+        }
+    }
+
+    if (map_init() != 0)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    if (strcmp(mode, "serve") == 0)
+    {
+        return run_serve();
+    }
+    if (strcmp(mode, "loadgen") == 0)
+    {
+        return run_loadgen();
+    }
+    if (strcmp(mode, "bench") == 0)
+    {
+        return run_bench();
+    }
+    fprintf(stderr, "unknown mode '%s'\n", mode);
+    return 2;
+}
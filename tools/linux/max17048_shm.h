@@ -0,0 +1,110 @@
+#ifndef MAX17048_SHM_H
+#define MAX17048_SHM_H
+
+/*
+ * Shared-memory publication of gauge snapshots on Linux.
+ *
+ * max17048d writes the latest snapshot into a POSIX shared-memory region
+ * guarded by a sequence lock. Readers map the region read-only and copy the
+ * snapshot without system calls or locks; a reader only retries if it raced
+ * with an update.
+ */
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "max17048_types.h"
+
+#define MAX17048_SHM_DEFAULT_NAME "/max17048"
+#define MAX17048_SHM_MAGIC 0x4D58534Du        // "MSXM"
+#define MAX17048_SHM_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    _Atomic uint32_t seq;                     // Odd while the writer is updating
+    uint32_t reserved;
+    max17048_snapshot_t snapshot;             // Latest snapshot, timestamp in CLOCK_MONOTONIC us
+    uint64_t updates;                         // Snapshots published
+    uint64_t errors;                          // Failed gauge reads
+} max17048_shm_region_t;
+
+typedef struct {
+    const max17048_shm_region_t *region;
+} max17048_shm_client_t;
+
+/**
+ * @brief Map a published region read-only.
+ *
+ * @return 0 on success, -1 with errno set otherwise.
+ */
+static inline int max17048_shm_open(const char *name, max17048_shm_client_t *client)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    void *map = mmap(NULL, sizeof(max17048_shm_region_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const max17048_shm_region_t *region = (const max17048_shm_region_t *)map;
+    if (region->magic != MAX17048_SHM_MAGIC || region->version != MAX17048_SHM_VERSION)
+    {
+        munmap(map, sizeof(max17048_shm_region_t));
+        return -1;
+    }
+    client->region = region;
+    return 0;
+}
+
+static inline void max17048_shm_close(max17048_shm_client_t *client)
+{
+    munmap((void *)client->region, sizeof(max17048_shm_region_t));
+    client->region = NULL;
+}
+
+/**
+ * @brief Copy the latest snapshot.
+ *
+ * @return Publication sequence of the copy (0 if nothing has been published yet).
+ */
+static inline uint32_t max17048_shm_read(const max17048_shm_client_t *client, max17048_snapshot_t *snapshot)
+{
+    max17048_shm_region_t *region = (max17048_shm_region_t *)client->region;
+    uint32_t begin, end;
+    do
+    {
+        begin = atomic_load_explicit(&region->seq, memory_order_acquire);
+        if (begin & 1)
+        {
+            continue;
+        }
+        memcpy(snapshot, (const void *)&region->snapshot, sizeof(*snapshot));
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&region->seq, memory_order_relaxed);
+    } while ((begin & 1) || begin != end);
+    return begin / 2;
+}
+
+/**
+ * @brief Writer side, used by max17048d.
+ */
+static inline void max17048_shm_publish(max17048_shm_region_t *region, const max17048_snapshot_t *snapshot)
+{
+    uint32_t seq = atomic_load_explicit(&region->seq, memory_order_relaxed);
+    atomic_store_explicit(&region->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy((void *)&region->snapshot, snapshot, sizeof(*snapshot));
+    region->updates++;
+    atomic_store_explicit(&region->seq, seq + 2, memory_order_release);
+}
+
+#endif // MAX17048_SHM_H
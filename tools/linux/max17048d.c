@@ -0,0 +1,163 @@
+/*
+ * Gauge daemon for Linux gateways.
+ *
+ * Samples a MAX17048 through i2c-dev with the same register bursts as the
+ * ESP-IDF driver (max17048_regs.h) and publishes each snapshot into a POSIX
+ * shared-memory seqlock region (max17048_shm.h). UI, logger and power
+ * manager processes then read the latest state without touching the bus.
+ *
+ * Build:
+ *     cc -O2 -Wall -I../../include -o max17048d max17048d.c -lrt
+ *
+ * Usage:
+ *     max17048d [-d /dev/i2c-1] [-a 0x36] [-p period_ms] [-n /max17048]
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "max17048_regs.h"
+#include "max17048_shm.h"
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void on_signal(int sig)
+{
+    (void)sig;
+    s_stop = 1;
+}
+
+static int64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Register pointer write + repeated START read, like i2c_master_transmit_receive()
+static int read_regs(int fd, uint16_t addr, uint8_t reg, uint8_t *buf, uint16_t len)
+{
+    struct i2c_msg msgs[2] = {
+        { .addr = addr, .flags = 0, .len = 1, .buf = &reg },
+        { .addr = addr, .flags = I2C_M_RD, .len = len, .buf = buf },
+    };
+    struct i2c_rdwr_ioctl_data xfer = { .msgs = msgs, .nmsgs = 2 };
+    return ioctl(fd, I2C_RDWR, &xfer) < 0 ? -1 : 0;
+}
+
+static int read_snapshot(int fd, uint16_t addr, max17048_snapshot_t *snapshot)
+{
+    uint8_t buf[4];
+    if (read_regs(fd, addr, MAX17048_VCELL_REG, buf, 4) != 0)
+    {
+        return -1;
+    }
+    snapshot->timestamp_us = monotonic_us();
+    max17048_regs_decode_vcell_soc(buf, snapshot);
+    if (read_regs(fd, addr, MAX17048_CRATE_REG, buf, 2) != 0)
+    {
+        return -1;
+    }
+    max17048_regs_decode_crate(buf, snapshot);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *device = "/dev/i2c-1";
+    const char *name = MAX17048_SHM_DEFAULT_NAME;
+    uint16_t addr = 0x36;
+    unsigned period_ms = 1000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:a:p:n:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'd':
+            device = optarg;
+            break;
+        case 'a':
+            addr = (uint16_t)strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            period_ms = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'n':
+            name = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-d i2c-dev] [-a addr] [-p period_ms] [-n shm-name]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (period_ms == 0)
+    {
+        period_ms = 1;
+    }
+
+    int i2c = open(device, O_RDWR);
+    if (i2c < 0)
+    {
+        fprintf(stderr, "open %s: %s\n", device, strerror(errno));
+        return 1;
+    }
+
+    int shm = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (shm < 0 || ftruncate(shm, sizeof(max17048_shm_region_t)) != 0)
+    {
+        fprintf(stderr, "shm %s: %s\n", name, strerror(errno));
+        return 1;
+    }
+    max17048_shm_region_t *region = mmap(NULL, sizeof(*region), PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+    close(shm);
+    if (region == MAP_FAILED)
+    {
+        fprintf(stderr, "mmap: %s\n", strerror(errno));
+        return 1;
+    }
+    memset(region, 0, sizeof(*region));
+    region->version = MAX17048_SHM_VERSION;
+    atomic_thread_fence(memory_order_release);
+    region->magic = MAX17048_SHM_MAGIC;
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!s_stop)
+    {
+        max17048_snapshot_t snapshot;
+        if (read_snapshot(i2c, addr, &snapshot) == 0)
+        {
+            max17048_shm_publish(region, &snapshot);
+        }
+        else
+        {
+            region->errors++;
+        }
+
+        next.tv_nsec += (long)(period_ms % 1000) * 1000000;
+        next.tv_sec += period_ms / 1000 + next.tv_nsec / 1000000000;
+        next.tv_nsec %= 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR && !s_stop)
+        {
+        }
+    }
+
+    munmap(region, sizeof(*region));
+    shm_unlink(name);
+    close(i2c);
+    return 0;
+}
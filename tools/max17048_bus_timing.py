@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+"""
+I2C bus-time cost model for the MAX17048 driver.
+
+Computes the bus time of every driver operation at a given SCL frequency from
+the I2C timing parameters (START/repeated START/STOP setup and hold times,
+9 clocks per byte including ACK, optional clock-stretch allowance per byte),
+then reports worst-case latency and bus utilisation for a sampling schedule.
+
+Example:
+    python3 max17048_bus_timing.py --freq 400000 \\
+        --schedule snapshot:1000 --schedule get_soc:100 --schedule pack_sweep:5000 --cells 4
+"""
+
+import argparse
+import sys
+
+# I2C timing minima in microseconds (UM10204, table 10)
+I2C_MODES = {
+    # name: (max_hz, tHD;STA, tSU;STA, tSU;STO, tBUF)
+    "standard": (100000, 4.0, 4.7, 4.0, 4.7),
+    "fast": (400000, 0.6, 0.6, 0.6, 1.3),
+    "fast_plus": (1000000, 0.26, 0.26, 0.26, 0.5),
+}
+
+GAUGE_ADDR = 0x36
+MODEL_TABLE_BYTES = 64   # 0x40-0x7F
+RCOMP_SEG_BYTES = 32     # 0x80-0x9F
+
+
+class Bus:
+    def __init__(self, freq_hz, stretch_us, overhead_us):
+        self.freq_hz = freq_hz
+        self.bit_us = 1e6 / freq_hz
+        self.stretch_us = stretch_us
+        self.overhead_us = overhead_us
+        for name, (max_hz, hd_sta, su_sta, su_sto, buf) in I2C_MODES.items():
+            if freq_hz <= max_hz:
+                self.mode = name
+                self.hd_sta, self.su_sta, self.su_sto, self.t_buf = hd_sta, su_sta, su_sto, buf
+                break
+        else:
+            raise ValueError("SCL frequency above Fast-mode Plus is not supported")
+
+    def start(self):
+        return self.hd_sta
+
+    def repeated_start(self):
+        # SCL low phase before SDA is released, then setup and hold of the new START
+        return self.bit_us / 2 + self.su_sta + self.hd_sta
+
+    def stop(self):
+        return self.su_sto + self.t_buf
+
+    def byte(self):
+        # 8 data bits + ACK/NACK
+        return 9 * self.bit_us + self.stretch_us
+
+
+class Txn:
+    """One I2C transaction (START ... STOP), the unit of bus arbitration."""
+
+    def __init__(self, write_bytes, read_bytes=0):
+        self.write_bytes = write_bytes  # includes the address byte
+        self.read_bytes = read_bytes    # data bytes after a repeated START + address
+
+    def bus_us(self, bus):
+        t = bus.start() + self.write_bytes * bus.byte()
+        if self.read_bytes:
+            t += bus.repeated_start() + (1 + self.read_bytes) * bus.byte()
+        return t + bus.stop()
+
+    def bytes_on_wire(self):
+        return self.write_bytes + (1 + self.read_bytes if self.read_bytes else 0)
+
+
+def read_regs(n):
+    # address+W, register pointer, repeated START, address+R, n data bytes
+    return Txn(2, n)
+
+
+def write_regs(n):
+    return Txn(2 + n)
+
+
+def mux_select():
+    # address+W, channel mask
+    return Txn(2)
+
+
+def operations(cells):
+    """Transactions and non-bus waits (ms) per driver operation."""
+    ops = {
+        "get_soc": ([read_regs(2)], 0),
+        "get_voltage": ([read_regs(2)], 0),
+        "get_crate": ([read_regs(2)], 0),
+        "get_version": ([read_regs(2)], 0),
+        "reset": ([write_regs(2)], 0),
+        "snapshot": ([read_regs(4), read_regs(2)], 0),
+        "snapshot_no_crate": ([read_regs(4)], 0),
+        # max17048_model_load(): unlock and read OCV, read CONFIG and HIBRT, table and
+        # RCOMPSeg bursts, force OCVTest, HIBRT off, lock, settle, read SOC, unlock and
+        # read OCV, restore CONFIG/OCV/HIBRT, lock, settle (unlock retries not counted)
+        "model_upload": ([write_regs(2), read_regs(2), read_regs(2), read_regs(2)]
+                         + [write_regs(16)] * (MODEL_TABLE_BYTES // 16)
+                         + [write_regs(16)] * (RCOMP_SEG_BYTES // 16)
+                         + [write_regs(2), write_regs(2), write_regs(2)]
+                         + [read_regs(2)]
+                         + [write_regs(2), read_regs(2), write_regs(2), write_regs(2), write_regs(2), write_regs(2)],
+                         200 + 150),
+    }
+    # One mux switch and one VCELL+SOC burst per cell (CRATE adds one read each)
+    ops["pack_sweep"] = ([mux_select(), read_regs(4)] * cells, 0)
+    ops["pack_sweep_crate"] = ([mux_select(), read_regs(4), read_regs(2)] * cells, 0)
+    return ops
+
+
+def parse_schedule(entries, ops):
+    schedule = []
+    for entry in entries:
+        name, _, period = entry.partition(":")
+        if name not in ops or not period:
+            raise ValueError("bad schedule entry '%s' (expected op:period_ms)" % entry)
+        schedule.append((name, float(period)))
+    return schedule
+
+
+def main():
+    parser = argparse.ArgumentParser(description="MAX17048 I2C bus-time cost model")
+    parser.add_argument("--freq", type=int, default=100000, help="SCL frequency in Hz (i2c_freq_hz)")
+    parser.add_argument("--stretch-us", type=float, default=0.0,
+                        help="clock-stretch allowance per byte in microseconds")
+    parser.add_argument("--overhead-us", type=float, default=0.0,
+                        help="driver/ISR overhead per transaction in microseconds")
+    parser.add_argument("--cells", type=int, default=1, help="gauges per pack sweep")
+    parser.add_argument("--foreign-txn-us", type=float, default=0.0,
+                        help="longest transaction of other devices sharing the bus")
+    parser.add_argument("--schedule", action="append", default=[], metavar="OP:PERIOD_MS",
+                        help="periodic operation, may be repeated")
+    args = parser.parse_args()
+
+    try:
+        bus = Bus(args.freq, args.stretch_us, args.overhead_us)
+        ops = operations(args.cells)
+        schedule = parse_schedule(args.schedule, ops)
+    except ValueError as e:
+        print("error: %s" % e, file=sys.stderr)
+        return 1
+
+    def txn_us(txn):
+        return txn.bus_us(bus) + bus.overhead_us
+
+    print("SCL %d Hz (%s mode), %.2f us/bit" % (bus.freq_hz, bus.mode, bus.bit_us))
+    print()
+    print("%-18s %5s %6s %12s %10s" % ("operation", "txns", "bytes", "bus_us", "wait_ms"))
+    for name, (txns, wait_ms) in ops.items():
+        total = sum(txn_us(t) for t in txns)
+        nbytes = sum(t.bytes_on_wire() for t in txns)
+        print("%-18s %5d %6d %12.1f %10.0f" % (name, len(txns), nbytes, total, wait_ms))
+
+    if not schedule:
+        return 0
+
+    # The bus is arbitrated per transaction, so before each transaction of an operation every
+    # other scheduled operation and the foreign device can each get one transaction in. The
+    # worst case waits for the longest transaction of all of them in turn.
+    print()
+    print("%-18s %10s %12s %14s" % ("scheduled", "period_ms", "bus_us", "worst_lat_us"))
+    utilisation = 0.0
+    for i, (name, period) in enumerate(schedule):
+        txns, wait_ms = ops[name]
+        own = sum(txn_us(t) for t in txns)
+        blocking = args.foreign_txn_us + sum(max(txn_us(t) for t in ops[other][0])
+                                             for j, (other, _) in enumerate(schedule) if j != i)
+        worst = own + len(txns) * blocking + wait_ms * 1000.0
+        utilisation += own / (period * 1000.0)
+        print("%-18s %10.1f %12.1f %14.1f" % (name, period, own, worst))
+
+    print()
+    print("bus utilisation: %.3f%%" % (utilisation * 100.0))
+    if utilisation > 1.0:
+        print("warning: schedule exceeds bus capacity", file=sys.stderr)
+        return 2
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,615 @@
+/*
+ * Battery-life projection for firmware duty cycles.
+ *
+ * Each scenario file describes a cell (capacity, internal resistance, OCV
+ * curve) and a duty cycle of current phases repeated until the battery is
+ * empty. The simulator integrates charge phase by phase, emulates the
+ * gauge registers at the driver's sampling period and runs them through the
+ * driver's register decoding and filter pipelines, so the projected end of
+ * life is the one the firmware would see. Time advances from event to event
+ * (phase edges and sample ticks), which runs years of battery life in well
+ * under a second. Scenarios are spread over worker threads.
+ *
+ * Build:
+ *     cc -O2 -Wall -pthread -I../../include -I../host_compat \
+ *        -o max17048_projection max17048_projection.c \
+ *        ../../max17048_filter.c ../../max17048_fmt.c
+ *
+ * Usage:
+ *     max17048_projection [-t threads] [-o csv_dir] [-c curve_s] [-y max_years] scenario...
+ *
+ * Scenario file, one key per line, '#' starts a comment:
+ *     name              beacon-v2.3
+ *     capacity_mah      2000
+ *     resistance_mohm   150
+ *     ocv_mv            3400 3600 3680 3730 3770 3800 3850 3920 4000 4080 4180   (0..100 % in 10 % steps)
+ *     cutoff_mv         3300
+ *     initial_soc       100
+ *     self_discharge    2                                (% per month)
+ *     sample_s          60                               (driver sampling period)
+ *     filter            vcell median 5                   (field, stage type, parameter)
+ *     phase             sleep 0.012 9.8                  (name, mA, seconds)
+ *     phase             radio 45 0.2
+ *
+ * With -o, SOC-over-time curves are written to <csv_dir>/<name>.csv, one
+ * row every curve_s seconds of simulated time.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "max17048_filter.h"
+#include "max17048_fmt.h"
+#include "max17048_regs.h"
+
+#define MAX_PHASES 64
+#define MAX_THREADS 64
+#define OCV_POINTS 11
+#define NAME_LEN 64
+#define SECONDS_PER_MONTH (30.0 * 86400.0)
+
+typedef struct {
+    char name[NAME_LEN];
+    double ma;
+    double seconds;
+} phase_t;
+
+typedef struct {
+    const char *path;
+    char name[NAME_LEN];
+    double capacity_mah;
+    double resistance_mohm;
+    uint16_t ocv_mv[OCV_POINTS];
+    uint16_t cutoff_mv;
+    double initial_soc;
+    double self_discharge_pct_month;
+    uint32_t sample_s;
+    max17048_filter_stage_config_t stages[MAX17048_FIELD_MAX][MAX17048_FILTER_MAX_STAGES];
+    size_t num_stages[MAX17048_FIELD_MAX];
+    phase_t phases[MAX_PHASES];
+    size_t num_phases;
+} scenario_t;
+
+typedef enum {
+    END_NONE,                                 // Still running at the time limit
+    END_CUTOFF,                               // Loaded voltage fell below the cutoff
+    END_EMPTY,                                // Charge exhausted
+} end_reason_t;
+
+typedef struct {
+    int ok;
+    char error[128];
+    double avg_ma;                            // Average current of one duty cycle
+    double brownout_s;                        // First time the loaded voltage dipped below cutoff_mv
+    end_reason_t brownout_reason;
+    double gauge_end_s;                       // First sample where the driver sees empty or below cutoff
+    end_reason_t gauge_reason;
+    double min_mv;                            // Lowest loaded voltage seen
+    double simulated_s;
+    uint64_t cycles;
+    uint64_t samples;
+    double wall_s;
+} result_t;
+
+typedef struct {
+    scenario_t *scenarios;
+    result_t *results;
+    size_t count;
+    size_t next;
+    pthread_mutex_t lock;
+    const char *csv_dir;
+    double curve_s;
+    double max_s;
+} job_t;
+
+static const uint16_t s_default_ocv_mv[OCV_POINTS] = {
+    3400, 3600, 3680, 3730, 3770, 3800, 3850, 3920, 4000, 4080, 4180,
+};
+
+// --- Scenario parsing ---
+
+static int parse_field(const char *s, max17048_field_t *field)
+{
+    static const char *names[MAX17048_FIELD_MAX] = { "vcell", "soc", "crate" };
+    for (int i = 0; i < MAX17048_FIELD_MAX; i++)
+    {
+        if (strcmp(s, names[i]) == 0)
+        {
+            *field = (max17048_field_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int parse_stage_type(const char *s, max17048_filter_type_t *type)
+{
+    static const char *names[] = { "median", "ema", "boxcar", "decimate", "rate_limit" };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (strcmp(s, names[i]) == 0)
+        {
+            *type = (max17048_filter_type_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void scenario_defaults(scenario_t *sc, const char *path)
+{
+    memset(sc, 0, sizeof(*sc));
+    sc->path = path;
+    const char *base = strrchr(path, '/');
+    snprintf(sc->name, sizeof(sc->name), "%s", base != NULL ? base + 1 : path);
+    char *dot = strrchr(sc->name, '.');
+    if (dot != NULL && dot != sc->name)
+    {
+        *dot = '\0';
+    }
+    sc->capacity_mah = 1000.0;
+    sc->resistance_mohm = 150.0;
+    memcpy(sc->ocv_mv, s_default_ocv_mv, sizeof(sc->ocv_mv));
+    sc->cutoff_mv = 3300;
+    sc->initial_soc = 100.0;
+    sc->sample_s = 60;
+}
+
+static int scenario_load(scenario_t *sc, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    scenario_defaults(sc, path);
+
+    char line[512];
+    int lineno = 0;
+    int err = 0;
+    while (err == 0 && fgets(line, sizeof(line), f) != NULL)
+    {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash != NULL)
+        {
+            *hash = '\0';
+        }
+        char key[32];
+        int used;
+        if (sscanf(line, "%31s%n", key, &used) != 1)
+        {
+            continue;
+        }
+        const char *rest = line + used;
+
+        if (strcmp(key, "name") == 0)
+        {
+            err = sscanf(rest, "%63s", sc->name) == 1 ? 0 : -1;
+        }
+        else if (strcmp(key, "capacity_mah") == 0)
+        {
+            err = sscanf(rest, "%lf", &sc->capacity_mah) == 1 && sc->capacity_mah > 0 ? 0 : -1;
+        }
+        else if (strcmp(key, "resistance_mohm") == 0)
+        {
+            err = sscanf(rest, "%lf", &sc->resistance_mohm) == 1 && sc->resistance_mohm >= 0 ? 0 : -1;
+        }
+        else if (strcmp(key, "ocv_mv") == 0)
+        {
+            for (int i = 0; err == 0 && i < OCV_POINTS; i++)
+            {
+                unsigned mv;
+                err = sscanf(rest, "%u%n", &mv, &used) == 1 && mv <= 5120 ? 0 : -1;
+                sc->ocv_mv[i] = (uint16_t)mv;
+                rest += used;
+            }
+        }
+        else if (strcmp(key, "cutoff_mv") == 0)
+        {
+            unsigned mv;
+            err = sscanf(rest, "%u", &mv) == 1 && mv <= 5120 ? 0 : -1;
+            sc->cutoff_mv = (uint16_t)mv;
+        }
+        else if (strcmp(key, "initial_soc") == 0)
+        {
+            err = sscanf(rest, "%lf", &sc->initial_soc) == 1 && sc->initial_soc > 0 && sc->initial_soc <= 100 ? 0 : -1;
+        }
+        else if (strcmp(key, "self_discharge") == 0)
+        {
+            err = sscanf(rest, "%lf", &sc->self_discharge_pct_month) == 1 && sc->self_discharge_pct_month >= 0 ? 0 : -1;
+        }
+        else if (strcmp(key, "sample_s") == 0)
+        {
+            err = sscanf(rest, "%u", &sc->sample_s) == 1 && sc->sample_s > 0 ? 0 : -1;
+        }
+        else if (strcmp(key, "filter") == 0)
+        {
+            char field_name[16], type_name[16];
+            unsigned param;
+            max17048_field_t field;
+            max17048_filter_type_t type;
+            err = sscanf(rest, "%15s %15s %u", field_name, type_name, &param) == 3 &&
+                  parse_field(field_name, &field) == 0 && parse_stage_type(type_name, &type) == 0 &&
+                  sc->num_stages[field] < MAX17048_FILTER_MAX_STAGES ? 0 : -1;
+            if (err == 0)
+            {
+                sc->stages[field][sc->num_stages[field]++] = (max17048_filter_stage_config_t){ type, (uint16_t)param };
+            }
+        }
+        else if (strcmp(key, "phase") == 0)
+        {
+            phase_t *p = &sc->phases[sc->num_phases];
+            err = sc->num_phases < MAX_PHASES && sscanf(rest, "%63s %lf %lf", p->name, &p->ma, &p->seconds) == 3 &&
+                  p->seconds > 0 ? 0 : -1;
+            sc->num_phases += err == 0;
+        }
+        else
+        {
+            err = -1;
+        }
+    }
+    fclose(f);
+
+    if (err != 0)
+    {
+        fprintf(stderr, "%s:%d: invalid line\n", path, lineno);
+        return -1;
+    }
+    if (sc->num_phases == 0)
+    {
+        fprintf(stderr, "%s: no phases\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// --- Cell and gauge emulation ---
+
+static double ocv_mv(const scenario_t *sc, double soc_pct)
+{
+    if (soc_pct <= 0)
+    {
+        return sc->ocv_mv[0];
+    }
+    if (soc_pct >= 100)
+    {
+        return sc->ocv_mv[OCV_POINTS - 1];
+    }
+    int seg = (int)(soc_pct / 10.0);
+    double frac = (soc_pct - seg * 10.0) / 10.0;
+    return sc->ocv_mv[seg] + (sc->ocv_mv[seg + 1] - sc->ocv_mv[seg]) * frac;
+}
+
+static uint16_t clamp_u16(double v)
+{
+    return v <= 0 ? 0 : v >= UINT16_MAX ? UINT16_MAX : (uint16_t)v;
+}
+
+static int16_t clamp_s16(double v)
+{
+    return v <= INT16_MIN ? INT16_MIN : v >= INT16_MAX ? INT16_MAX : (int16_t)v;
+}
+
+// Emulated register values at one sample tick; CRATE is the SOC rate over the last sample period
+static void gauge_read(const scenario_t *sc, double soc_pct, double now_ma, double period_mah, double period_s,
+                       max17048_snapshot_t *snap)
+{
+    double loaded_mv = ocv_mv(sc, soc_pct) - now_ma * sc->resistance_mohm / 1000.0;
+    snap->vcell = clamp_u16(loaded_mv * 1000.0 / (MAX17048_VCELL_LSB_V * 1e6));
+    snap->soc = clamp_u16(soc_pct / MAX17048_SOC_LSB_PCT);
+    double pct_hr = -period_mah / sc->capacity_mah * 100.0 * 3600.0 / period_s;
+    snap->crate = clamp_s16(pct_hr / MAX17048_CRATE_LSB_PCT_HR);
+}
+
+static void curve_row(FILE *csv, double t_s, double soc_pct, const max17048_snapshot_t *snap)
+{
+    char soc[MAX17048_FMT_MAX_LEN], vcell[MAX17048_FMT_MAX_LEN], crate[MAX17048_FMT_MAX_LEN];
+    max17048_fmt_soc(soc, sizeof(soc), snap->soc, 2);
+    max17048_fmt_vcell(vcell, sizeof(vcell), snap->vcell, 3);
+    max17048_fmt_crate(crate, sizeof(crate), snap->crate, 2);
+    fprintf(csv, "%.3f,%s,%s,%s,%.3f\n", t_s / 3600.0, soc, vcell, crate, soc_pct);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// --- Simulation ---
+
+static void simulate(const scenario_t *sc, const job_t *job, result_t *res)
+{
+    double start = now_s();
+    memset(res, 0, sizeof(*res));
+
+    // Driver side: one pipeline per field, as max17048_sampler_set_filter() would attach them
+    max17048_filter_t filters[MAX17048_FIELD_MAX];
+    for (int f = 0; f < MAX17048_FIELD_MAX; f++)
+    {
+        if (sc->num_stages[f] > 0 && max17048_filter_init(&filters[f], sc->stages[f], sc->num_stages[f]) != ESP_OK)
+        {
+            snprintf(res->error, sizeof(res->error), "invalid filter on field %d", f);
+            return;
+        }
+    }
+
+    FILE *csv = NULL;
+    if (job->csv_dir != NULL)
+    {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.csv", job->csv_dir, sc->name);
+        csv = fopen(path, "w");
+        if (csv == NULL)
+        {
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+            snprintf(res->error, sizeof(res->error), "cannot write curve");
+            return;
+        }
+        fprintf(csv, "hours,soc_pct,vcell_v,crate_pct_hr,true_soc_pct\n");
+    }
+
+    double cycle_s = 0, cycle_mah = 0;
+    for (size_t i = 0; i < sc->num_phases; i++)
+    {
+        cycle_s += sc->phases[i].seconds;
+        cycle_mah += sc->phases[i].ma * sc->phases[i].seconds / 3600.0;
+    }
+    double self_ma = sc->capacity_mah * sc->self_discharge_pct_month / 100.0 / (SECONDS_PER_MONTH / 3600.0);
+    res->avg_ma = cycle_mah * 3600.0 / cycle_s + self_ma;
+    res->min_mv = 1e9;
+
+    double charge_mah = sc->capacity_mah * sc->initial_soc / 100.0;
+    double t = 0, next_tick = sc->sample_s, next_curve = 0, period_mah = 0;
+    size_t phase = 0;
+    double phase_left = sc->phases[0].seconds;
+    max17048_snapshot_t snap = { 0 };
+
+    while (t < job->max_s && (res->brownout_reason == END_NONE || res->gauge_reason == END_NONE))
+    {
+        double ma = sc->phases[phase].ma + self_ma;
+        double dt = phase_left < next_tick - t ? phase_left : next_tick - t;
+        double drawn = ma * dt / 3600.0;
+        charge_mah -= drawn;
+        period_mah += drawn;
+        t += dt;
+        phase_left -= dt;
+
+        // Voltage sags most at the end of a segment, where SOC is lowest
+        double soc_pct = charge_mah / sc->capacity_mah * 100.0;
+        double loaded_mv = ocv_mv(sc, soc_pct) - ma * sc->resistance_mohm / 1000.0;
+        res->min_mv = loaded_mv < res->min_mv ? loaded_mv : res->min_mv;
+        if (res->brownout_reason == END_NONE && (charge_mah <= 0 || loaded_mv < sc->cutoff_mv))
+        {
+            res->brownout_s = t;
+            res->brownout_reason = charge_mah <= 0 ? END_EMPTY : END_CUTOFF;
+        }
+        if (charge_mah <= 0)
+        {
+            charge_mah = 0;
+            soc_pct = 0;
+        }
+
+        if (phase_left <= 1e-9)
+        {
+            if (++phase == sc->num_phases)
+            {
+                phase = 0;
+                res->cycles++;
+            }
+            phase_left = sc->phases[phase].seconds;
+        }
+
+        if (t >= next_tick - 1e-9)
+        {
+            gauge_read(sc, soc_pct, sc->phases[phase].ma + self_ma, period_mah, sc->sample_s, &snap);
+            period_mah = 0;
+            next_tick += sc->sample_s;
+            res->samples++;
+
+            // As in the sampler task: every pipeline sees every read, and the snapshot is
+            // delivered only when all of them emit
+            int32_t value[MAX17048_FIELD_MAX] = { snap.vcell, snap.soc, snap.crate };
+            bool deliver = true;
+            for (int field = 0; field < MAX17048_FIELD_MAX; field++)
+            {
+                if (sc->num_stages[field] > 0 && !max17048_filter_process(&filters[field], value[field], &value[field]))
+                {
+                    deliver = false;
+                }
+            }
+            snap.vcell = (uint16_t)value[MAX17048_FIELD_VCELL];
+            snap.soc = (uint16_t)value[MAX17048_FIELD_SOC];
+            snap.crate = (int16_t)value[MAX17048_FIELD_CRATE];
+
+            if (deliver && res->gauge_reason == END_NONE)
+            {
+                if (snap.soc == 0)
+                {
+                    res->gauge_reason = END_EMPTY;
+                    res->gauge_end_s = t;
+                }
+                else if (max17048_regs_vcell_uv(snap.vcell) < (uint32_t)sc->cutoff_mv * 1000)
+                {
+                    res->gauge_reason = END_CUTOFF;
+                    res->gauge_end_s = t;
+                }
+            }
+            if (deliver && csv != NULL && t >= next_curve)
+            {
+                curve_row(csv, t, soc_pct, &snap);
+                next_curve += job->curve_s;
+            }
+        }
+
+        if (charge_mah <= 0 && res->gauge_reason == END_NONE && res->samples > 0 && t > res->brownout_s + sc->sample_s)
+        {
+            // Empty battery, but the filters never let the driver see it
+            break;
+        }
+    }
+
+    if (csv != NULL)
+    {
+        fclose(csv);
+    }
+    res->simulated_s = t;
+    res->wall_s = now_s() - start;
+    res->ok = 1;
+}
+
+static void *worker(void *arg)
+{
+    job_t *job = arg;
+    for (;;)
+    {
+        pthread_mutex_lock(&job->lock);
+        size_t i = job->next++;
+        pthread_mutex_unlock(&job->lock);
+        if (i >= job->count)
+        {
+            return NULL;
+        }
+        simulate(&job->scenarios[i], job, &job->results[i]);
+    }
+}
+
+// --- Report ---
+
+static const char *end_name(end_reason_t reason)
+{
+    return reason == END_CUTOFF ? "cutoff" : reason == END_EMPTY ? "empty" : "running";
+}
+
+static void report(const job_t *job)
+{
+    printf("%-20s %10s %12s %8s %12s %8s %8s %9s %10s\n", "scenario", "avg mA", "brownout d", "by",
+           "gauge end d", "by", "min V", "vs first", "speedup");
+    double first = 0;
+    for (size_t i = 0; i < job->count; i++)
+    {
+        const scenario_t *sc = &job->scenarios[i];
+        const result_t *r = &job->results[i];
+        if (!r->ok)
+        {
+            printf("%-20s error: %s\n", sc->name, r->error);
+            continue;
+        }
+
+        double life_s = r->brownout_reason != END_NONE ? r->brownout_s : r->simulated_s;
+        if (i == 0)
+        {
+            first = life_s;
+        }
+        char delta[16] = "-";
+        if (i > 0 && first > 0)
+        {
+            snprintf(delta, sizeof(delta), "%+.1f%%", (life_s - first) / first * 100.0);
+        }
+        printf("%-20s %10.4f %12.2f %8s %12.2f %8s %8.3f %9s %9.0fx\n", sc->name, r->avg_ma, life_s / 86400.0,
+               end_name(r->brownout_reason), (r->gauge_reason != END_NONE ? r->gauge_end_s : r->simulated_s) / 86400.0,
+               end_name(r->gauge_reason), r->min_mv / 1000.0, delta, r->wall_s > 0 ? r->simulated_s / r->wall_s : 0.0);
+    }
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-t threads] [-o csv_dir] [-c curve_s] [-y max_years] scenario...\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = ncpu > 0 ? (int)ncpu : 1;
+    job_t job = { .curve_s = 3600, .max_s = 10 * 365 * 86400.0 };
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:o:c:y:")) != -1)
+    {
+        switch (opt)
+        {
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'o':
+            job.csv_dir = optarg;
+            break;
+        case 'c':
+            job.curve_s = atof(optarg);
+            break;
+        case 'y':
+            job.max_s = atof(optarg) * 365 * 86400.0;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (optind >= argc || threads <= 0 || job.curve_s <= 0 || job.max_s <= 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    job.count = (size_t)(argc - optind);
+    job.scenarios = calloc(job.count, sizeof(scenario_t));
+    job.results = calloc(job.count, sizeof(result_t));
+    if (job.scenarios == NULL || job.results == NULL)
+    {
+        return 1;
+    }
+    for (size_t i = 0; i < job.count; i++)
+    {
+        if (scenario_load(&job.scenarios[i], argv[optind + (int)i]) != 0)
+        {
+            return 1;
+        }
+    }
+
+    threads = threads > (int)job.count ? (int)job.count : threads;
+    threads = threads > MAX_THREADS ? MAX_THREADS : threads;
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_t tids[MAX_THREADS];
+    double start = now_s();
+    int started = 0;
+    while (started < threads)
+    {
+        int err = pthread_create(&tids[started], NULL, worker, &job);
+        if (err != 0)
+        {
+            // Scenarios are taken from a shared index, so fewer threads still run them all
+            fprintf(stderr, "warning: only %d of %d threads started: %s\n", started, threads, strerror(err));
+            break;
+        }
+        started++;
+    }
+    if (started == 0)
+    {
+        worker(&job);
+    }
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(tids[i], NULL);
+    }
+    threads = started > 0 ? started : 1;
+
+    report(&job);
+    printf("%zu scenario(s) on %d thread(s) in %.3f s\n", job.count, threads, now_s() - start);
+
+    int failed = 0;
+    for (size_t i = 0; i < job.count; i++)
+    {
+        failed |= !job.results[i].ok;
+    }
+    free(job.scenarios);
+    free(job.results);
+    return failed;
+}